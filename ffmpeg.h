@@ -474,6 +474,7 @@ extern int audio_sync_method;
 extern int video_sync_method;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern int filter_branch_threads;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
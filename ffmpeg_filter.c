@@ -847,6 +847,10 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    if (do_benchmark_all)
+        av_opt_set_int(fg->graph, "timing", 1, 0);
+    if (filter_branch_threads && !simple)
+        av_opt_set_int(fg->graph, "branch_threads", 1, 0);
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -98,6 +98,7 @@ int print_stats       = -1;
 int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
+int filter_branch_threads = 0;
 float max_error_rate  = 2.0/3;
 
 
@@ -2854,6 +2855,8 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
         "read complex filtergraph description from a file", "filename" },
+    { "filter_branch_threads", OPT_BOOL | OPT_EXPERT,                { &filter_branch_threads },
+        "run the branches of complex filtergraphs in their own threads" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT |
@@ -89,6 +89,12 @@ const int program_birth_year = 2003;
 #define EXTERNAL_CLOCK_SPEED_MAX  1.010
 #define EXTERNAL_CLOCK_SPEED_STEP 0.001
 
+/* trick play: maximum playback speed, and the speeds from which only the
+ * reference frames, then only the key frames are decoded */
+#define PLAYBACK_SPEED_MAX          16.0
+#define PLAYBACK_SPEED_SKIP_NONREF   2.0
+#define PLAYBACK_SPEED_SKIP_NONKEY   8.0
+
 /* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
 #define AUDIO_DIFF_AVG_NB   20
 
@@ -189,6 +195,7 @@ typedef struct VideoState {
     Clock audclk;
     Clock vidclk;
     Clock extclk;
+    double speed;           /* playback speed, above 1 for trick play */
 
     int audio_stream;
 
@@ -330,6 +337,7 @@ static int nb_vfilters = 0;
 static char *afilters = NULL;
 #endif
 static int autorotate = 1;
+static double playback_speed = 1.0;
 
 /* current context */
 static int is_full_screen;
@@ -1188,6 +1196,9 @@ static void sync_clock_to_slave(Clock *c, Clock *slave)
 }
 
 static int get_master_sync_type(VideoState *is) {
+    /* in trick play the video follows the sped up external clock */
+    if (is->speed != 1.0)
+        return AV_SYNC_EXTERNAL_CLOCK;
     if (is->av_sync_type == AV_SYNC_VIDEO_MASTER) {
         if (is->video_st)
             return AV_SYNC_VIDEO_MASTER;
@@ -1236,6 +1247,38 @@ static void check_external_clock_speed(VideoState *is) {
    }
 }
 
+/* change the playback speed. Audio is muted above normal speed, and the
+ * decoder skips the non reference frames, then the demuxer drops all but
+ * the key frames, to keep up at high speeds */
+static void set_playback_speed(VideoState *is, double speed)
+{
+    enum AVDiscard skip = AVDISCARD_DEFAULT;
+
+    speed = av_clipd(speed, 1.0, PLAYBACK_SPEED_MAX);
+    if (speed == is->speed)
+        return;
+    if (speed >= PLAYBACK_SPEED_SKIP_NONKEY)
+        skip = AVDISCARD_NONKEY;
+    else if (speed >= PLAYBACK_SPEED_SKIP_NONREF)
+        skip = AVDISCARD_NONREF;
+
+    if (is->video_st) {
+        is->video_st->codec->skip_frame = skip;
+        is->video_st->discard = skip == AVDISCARD_NONKEY ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    }
+    if (is->audio_st) {
+        is->audio_st->discard = speed != 1.0 ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+        if (is->speed == 1.0) {
+            packet_queue_flush(&is->audioq);
+            packet_queue_put(&is->audioq, &flush_pkt);
+        }
+    }
+
+    set_clock_speed(&is->extclk, speed);
+    is->speed = speed;
+    av_log(NULL, AV_LOG_INFO, "Playback speed %gx\n", speed);
+}
+
 /* seek in the stream */
 static void stream_seek(VideoState *is, int64_t pos, int64_t rel, int seek_by_bytes)
 {
@@ -1362,7 +1405,7 @@ static void video_refresh(void *opaque, double *remaining_time)
 
     SubPicture *sp, *sp2;
 
-    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK && is->realtime)
+    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK && is->realtime && is->speed == 1.0)
         check_external_clock_speed(is);
 
     if (!display_disable && is->show_mode != SHOW_MODE_VIDEO && is->audio_st) {
@@ -2205,6 +2248,9 @@ static int audio_decode_frame(VideoState *is)
     int ret;
     int reconfigure;
 
+    if (is->speed != 1.0)
+        return -1;
+
     for (;;) {
         /* NOTE: the audio packet can contain several frames */
         while (pkt_temp->stream_index != -1 || is->audio_buf_frames_pending) {
@@ -2218,7 +2264,7 @@ static int audio_decode_frame(VideoState *is)
             if (is->audioq.serial != is->audio_pkt_temp_serial)
                 break;
 
-            if (is->paused)
+            if (is->paused || is->speed != 1.0)
                 return -1;
 
             if (!is->audio_buf_frames_pending) {
@@ -2910,6 +2956,9 @@ static int read_thread(void *arg)
     if (infinite_buffer < 0 && is->realtime)
         infinite_buffer = 1;
 
+    if (playback_speed != 1.0)
+        set_playback_speed(is, playback_speed);
+
     for (;;) {
         if (is->abort_request)
             break;
@@ -2980,7 +3029,7 @@ static int read_thread(void *arg)
         /* if the queue are full, no need to read more */
         if (infinite_buffer<1 &&
               (is->audioq.size + is->videoq.size + is->subtitleq.size > MAX_QUEUE_SIZE
-            || (   (is->audioq   .nb_packets > MIN_FRAMES || is->audio_stream < 0 || is->audioq.abort_request)
+            || (   (is->audioq   .nb_packets > MIN_FRAMES || is->audio_stream < 0 || is->audioq.abort_request || is->speed != 1.0)
                 && (is->videoq   .nb_packets > MIN_FRAMES || is->video_stream < 0 || is->videoq.abort_request
                     || (is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC))
                 && (is->subtitleq.nb_packets > MIN_FRAMES || is->subtitle_stream < 0 || is->subtitleq.abort_request)))) {
@@ -2991,7 +3040,7 @@ static int read_thread(void *arg)
             continue;
         }
         if (!is->paused &&
-            (!is->audio_st || is->audio_finished == is->audioq.serial) &&
+            (!is->audio_st || is->audio_finished == is->audioq.serial || is->speed != 1.0) &&
             (!is->video_st || (is->video_finished == is->videoq.serial && pictq_nb_remaining(is) == 0))) {
             if (loop != 1 && (!loop || --loop)) {
                 stream_seek(is, start_time != AV_NOPTS_VALUE ? start_time : 0, 0, 0);
@@ -3029,7 +3078,7 @@ static int read_thread(void *arg)
                 av_q2d(ic->streams[pkt->stream_index]->time_base) -
                 (double)(start_time != AV_NOPTS_VALUE ? start_time : 0) / 1000000
                 <= ((double)duration / 1000000);
-        if (pkt->stream_index == is->audio_stream && pkt_in_play_range) {
+        if (pkt->stream_index == is->audio_stream && pkt_in_play_range && is->speed == 1.0) {
             packet_queue_put(&is->audioq, pkt);
         } else if (pkt->stream_index == is->video_stream && pkt_in_play_range
                    && !(is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
@@ -3097,6 +3146,7 @@ static VideoState *stream_open(const char *filename, AVInputFormat *iformat)
     init_clock(&is->vidclk, &is->videoq.serial);
     init_clock(&is->audclk, &is->audioq.serial);
     init_clock(&is->extclk, &is->extclk.serial);
+    is->speed = 1.0;
     is->audio_clock_serial = -1;
     is->audio_last_serial = -1;
     is->av_sync_type = av_sync_type;
@@ -3290,6 +3340,12 @@ static void event_loop(VideoState *cur_stream)
             case SDLK_s: // S: Step to next frame
                 step_to_next_frame(cur_stream);
                 break;
+            case SDLK_RIGHTBRACKET:
+                set_playback_speed(cur_stream, cur_stream->speed * 2);
+                break;
+            case SDLK_LEFTBRACKET:
+                set_playback_speed(cur_stream, cur_stream->speed / 2);
+                break;
             case SDLK_a:
                 stream_cycle_channel(cur_stream, AVMEDIA_TYPE_AUDIO);
                 break;
@@ -3592,6 +3648,7 @@ static const OptionDef options[] = {
     { "scodec", HAS_ARG | OPT_STRING | OPT_EXPERT, { &subtitle_codec_name }, "force subtitle decoder", "decoder_name" },
     { "vcodec", HAS_ARG | OPT_STRING | OPT_EXPERT, {    &video_codec_name }, "force video decoder",    "decoder_name" },
     { "autorotate", OPT_BOOL, { &autorotate }, "automatically rotate video", "" },
+    { "speed", OPT_DOUBLE | HAS_ARG, { &playback_speed }, "set the playback speed, from 1 to 16", "speed" },
     { NULL, },
 };
 
@@ -3626,6 +3683,7 @@ void show_help_default(const char *opt, const char *arg)
            "c                   cycle program\n"
            "w                   cycle video filters or show modes\n"
            "s                   activate frame-step mode\n"
+           "[ ]                 halve/double the playback speed\n"
            "left/right          seek backward/forward 10 seconds\n"
            "down/up             seek backward/forward 1 minute\n"
            "page down/page up   seek backward/forward 10 minutes\n"
@@ -0,0 +1,250 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the H.264 decoder output delay, in packets, for small generated
+ * streams made of an I_PCM IDR picture followed by skipped P pictures,
+ * with and without frame threading and CODEC_FLAG_LOW_DELAY. The pictures are in output order
+ * and their POC is incremented by 4, as done by some IP cameras.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/frame.h"
+
+#include "avcodec.h"
+#include "golomb.h"
+#include "put_bits.h"
+
+#define NB_FRAMES 8
+#define MB_WIDTH  2
+#define MB_HEIGHT 2
+
+static uint8_t stream[NB_FRAMES][4096];
+static int     stream_size[NB_FRAMES];
+
+/* Escape the RBSP and append it to buf as an Annex B NAL unit. */
+static int put_nal(uint8_t *buf, PutBitContext *pb, int nal_ref_idc, int type)
+{
+    const uint8_t *rbsp = pb->buf;
+    int i, size, len = 0, zeros = 0;
+
+    put_bits(pb, 1, 1);     /* rbsp_stop_one_bit */
+    avpriv_align_put_bits(pb);
+    flush_put_bits(pb);
+    size = put_bits_count(pb) >> 3;
+
+    AV_WB32(buf, 1);
+    buf[4] = nal_ref_idc << 5 | type;
+    len    = 5;
+    for (i = 0; i < size; i++) {
+        if (zeros == 2 && rbsp[i] <= 3) {
+            buf[len++] = 3;
+            zeros      = 0;
+        }
+        zeros      = rbsp[i] ? 0 : zeros + 1;
+        buf[len++] = rbsp[i];
+    }
+    return len;
+}
+
+static int put_sps(uint8_t *buf, int reorder_info)
+{
+    uint8_t rbsp[64];
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, sizeof(rbsp));
+    put_bits(&pb, 8, 66);           /* profile_idc: baseline */
+    put_bits(&pb, 8, 0x40);         /* constraint_set1_flag */
+    put_bits(&pb, 8, 30);           /* level_idc */
+    set_ue_golomb(&pb, 0);          /* seq_parameter_set_id */
+    set_ue_golomb(&pb, 0);          /* log2_max_frame_num_minus4 */
+    set_ue_golomb(&pb, 0);          /* pic_order_cnt_type */
+    set_ue_golomb(&pb, 4);          /* log2_max_pic_order_cnt_lsb_minus4 */
+    set_ue_golomb(&pb, 1);          /* max_num_ref_frames */
+    put_bits(&pb, 1, 0);            /* gaps_in_frame_num_value_allowed_flag */
+    set_ue_golomb(&pb, MB_WIDTH  - 1);
+    set_ue_golomb(&pb, MB_HEIGHT - 1);
+    put_bits(&pb, 1, 1);            /* frame_mbs_only_flag */
+    put_bits(&pb, 1, 1);            /* direct_8x8_inference_flag */
+    put_bits(&pb, 1, 0);            /* frame_cropping_flag */
+    put_bits(&pb, 1, reorder_info); /* vui_parameters_present_flag */
+    if (reorder_info) {
+        put_bits(&pb, 8, 0);        /* aspect_ratio_info_present_flag ... pic_struct_present_flag */
+        put_bits(&pb, 1, 1);        /* bitstream_restriction_flag */
+        put_bits(&pb, 1, 1);        /* motion_vectors_over_pic_boundaries_flag */
+        set_ue_golomb(&pb, 0);      /* max_bytes_per_pic_denom */
+        set_ue_golomb(&pb, 0);      /* max_bits_per_mb_denom */
+        set_ue_golomb(&pb, 16);     /* log2_max_mv_length_horizontal */
+        set_ue_golomb(&pb, 16);     /* log2_max_mv_length_vertical */
+        set_ue_golomb(&pb, 0);      /* max_num_reorder_frames */
+        set_ue_golomb(&pb, 1);      /* max_dec_frame_buffering */
+    }
+    return put_nal(buf, &pb, 3, 7);
+}
+
+static int put_pps(uint8_t *buf)
+{
+    uint8_t rbsp[64];
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, sizeof(rbsp));
+    set_ue_golomb(&pb, 0);          /* pic_parameter_set_id */
+    set_ue_golomb(&pb, 0);          /* seq_parameter_set_id */
+    put_bits(&pb, 1, 0);            /* entropy_coding_mode_flag */
+    put_bits(&pb, 1, 0);            /* bottom_field_pic_order_in_frame_present_flag */
+    set_ue_golomb(&pb, 0);          /* num_slice_groups_minus1 */
+    set_ue_golomb(&pb, 0);          /* num_ref_idx_l0_default_active_minus1 */
+    set_ue_golomb(&pb, 0);          /* num_ref_idx_l1_default_active_minus1 */
+    put_bits(&pb, 1, 0);            /* weighted_pred_flag */
+    put_bits(&pb, 2, 0);            /* weighted_bipred_idc */
+    set_se_golomb(&pb, 0);          /* pic_init_qp_minus26 */
+    set_se_golomb(&pb, 0);          /* pic_init_qs_minus26 */
+    set_se_golomb(&pb, 0);          /* chroma_qp_index_offset */
+    put_bits(&pb, 1, 1);            /* deblocking_filter_control_present_flag */
+    put_bits(&pb, 1, 0);            /* constrained_intra_pred_flag */
+    put_bits(&pb, 1, 0);            /* redundant_pic_cnt_present_flag */
+    return put_nal(buf, &pb, 3, 8);
+}
+
+static int put_slice(uint8_t *buf, int n)
+{
+    uint8_t rbsp[2048];
+    PutBitContext pb;
+    int i, j;
+
+    init_put_bits(&pb, rbsp, sizeof(rbsp));
+    set_ue_golomb(&pb, 0);          /* first_mb_in_slice */
+    set_ue_golomb(&pb, n ? 5 : 7);  /* slice_type: P or I */
+    set_ue_golomb(&pb, 0);          /* pic_parameter_set_id */
+    put_bits(&pb, 4, n & 15);       /* frame_num */
+    if (!n)
+        set_ue_golomb(&pb, 0);      /* idr_pic_id */
+    put_bits(&pb, 8, 4 * n & 255);  /* pic_order_cnt_lsb */
+    if (n) {
+        put_bits(&pb, 1, 0);        /* num_ref_idx_active_override_flag */
+        put_bits(&pb, 1, 0);        /* ref_pic_list_modification_flag_l0 */
+        put_bits(&pb, 1, 0);        /* adaptive_ref_pic_marking_mode_flag */
+    } else {
+        put_bits(&pb, 1, 0);        /* no_output_of_prior_pics_flag */
+        put_bits(&pb, 1, 0);        /* long_term_reference_flag */
+    }
+    set_se_golomb(&pb, 0);          /* slice_qp_delta */
+    set_ue_golomb(&pb, 1);          /* disable_deblocking_filter_idc */
+
+    if (n) {
+        set_ue_golomb(&pb, MB_WIDTH * MB_HEIGHT); /* mb_skip_run */
+    } else {
+        for (i = 0; i < MB_WIDTH * MB_HEIGHT; i++) {
+            set_ue_golomb(&pb, 25); /* mb_type: I_PCM */
+            avpriv_align_put_bits(&pb);
+            for (j = 0; j < 256 + 2 * 64; j++)
+                put_bits(&pb, 8, 0x80 + i * 16);
+        }
+    }
+    return put_nal(buf, &pb, n ? 2 : 3, n ? 1 : 5);
+}
+
+static void build_stream(int reorder_info)
+{
+    int n;
+
+    for (n = 0; n < NB_FRAMES; n++) {
+        uint8_t *buf = stream[n];
+        int len = 0;
+
+        if (!n) {
+            len += put_sps(buf + len, reorder_info);
+            len += put_pps(buf + len);
+        }
+        len += put_slice(buf + len, n);
+        stream_size[n] = len;
+    }
+}
+
+static int run(int reorder_info, int flags, int threads)
+{
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket pkt;
+    int n, got_frame, ret = 0;
+
+    if (!avctx || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->flags       |= flags;
+    avctx->thread_count = threads;
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0)
+        goto end;
+
+    printf("vui: %d, low_delay: %d, threads: %d\n",
+           reorder_info, !!(flags & CODEC_FLAG_LOW_DELAY), threads);
+    build_stream(reorder_info);
+
+    for (n = 0; n <= NB_FRAMES + threads; n++) {
+        av_init_packet(&pkt);
+        if (n < NB_FRAMES) {
+            pkt.data = stream[n];
+            pkt.size = stream_size[n];
+            pkt.pts  = n;
+        } else {
+            pkt.data = NULL;
+            pkt.size = 0;
+        }
+        ret = avcodec_decode_video2(avctx, frame, &got_frame, &pkt);
+        if (ret < 0) {
+            printf("packet %d: decoding failed\n", n);
+            goto end;
+        }
+        if (got_frame) {
+            if (n < NB_FRAMES)
+                printf("packet %d: frame %"PRId64", delay %"PRId64"\n",
+                       n, frame->pkt_pts, n - frame->pkt_pts);
+            else
+                printf("flush: frame %"PRId64"\n", frame->pkt_pts);
+            av_frame_unref(frame);
+        }
+    }
+    ret = 0;
+
+end:
+    avcodec_close(avctx);
+    av_free(avctx);
+    av_frame_free(&frame);
+    return ret;
+}
+
+int main(void)
+{
+    int vui;
+
+    avcodec_register_all();
+
+    for (vui = 0; vui < 2; vui++) {
+        if (run(vui, 0, 1) < 0 ||
+            run(vui, 0, 2) < 0 ||
+            run(vui, CODEC_FLAG_LOW_DELAY, 2) < 0)
+            return 1;
+    }
+    return 0;
+}
@@ -1733,6 +1733,8 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0,
         hevc_await_progress(s, ref1, &current_mv.mv[1], y0, nPbH);
     }
 
+    HEVC_TIMER_START(lc, HEVC_STAGE_MC);
+
     if (current_mv.pred_flag == PF_L0) {
         int x0_c = x0 >> s->sps->hshift[1];
         int y0_c = y0 >> s->sps->vshift[1];
@@ -1784,6 +1786,8 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0,
         chroma_mc_bi(s, dst2, s->frame->linesize[2], ref0->frame, ref1->frame,
                      x0_c, y0_c, nPbW_c, nPbH_c, &current_mv, 1);
     }
+
+    HEVC_TIMER_STOP(lc, HEVC_STAGE_MC);
 }
 
 /**
@@ -2305,7 +2309,9 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
         s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
         s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
 
+        HEVC_TIMER_START(s->HEVClc, HEVC_STAGE_CTB);
         more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
+        HEVC_TIMER_STOP(s->HEVClc, HEVC_STAGE_CTB);
         if (more_data < 0) {
             s->tab_slice_address[ctb_addr_rs] = -1;
             return more_data;
@@ -2374,7 +2380,9 @@ static int hls_decode_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int
 
         ff_hevc_cabac_init(s, ctb_addr_ts);
         hls_sao_param(s, x_ctb >> s->sps->log2_ctb_size, y_ctb >> s->sps->log2_ctb_size);
+        HEVC_TIMER_START(s->HEVClc, HEVC_STAGE_CTB);
         more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
+        HEVC_TIMER_STOP(s->HEVClc, HEVC_STAGE_CTB);
 
         if (more_data < 0) {
             s->tab_slice_address[ctb_addr_rs] = -1;
@@ -3128,12 +3136,46 @@ fail:
     return AVERROR(ENOMEM);
 }
 
+#if HEVC_STAGE_TIMERS
+static av_cold void log_stage_timers(HEVCContext *s)
+{
+    static const char *const stage_names[HEVC_STAGE_NB] = {
+        [HEVC_STAGE_CTB]      = "hevc ctb",
+        [HEVC_STAGE_RESIDUAL] = "hevc residual",
+        [HEVC_STAGE_MC]       = "hevc mc",
+        [HEVC_STAGE_DEBLOCK]  = "hevc deblock",
+        [HEVC_STAGE_SAO]      = "hevc sao",
+    };
+    int i, j;
+
+    for (i = 0; i < HEVC_STAGE_NB; i++) {
+        uint64_t time = 0;
+        unsigned count = 0;
+
+        for (j = 0; j < MAX_NB_THREADS; j++) {
+            if (!s->HEVClcList[j])
+                continue;
+            time  += s->HEVClcList[j]->stage_time[i];
+            count += s->HEVClcList[j]->stage_count[i];
+        }
+        if (count)
+            av_log(s->avctx, AV_LOG_INFO,
+                   "%"PRIu64" " FF_TIMER_UNITS " in %s, %u runs, 0 skips\n",
+                   time * 10 / count, stage_names[i], count);
+    }
+}
+#endif
+
 static av_cold int hevc_decode_free(AVCodecContext *avctx)
 {
     HEVCContext       *s = avctx->priv_data;
     HEVCLocalContext *lc = s->HEVClc;
     int i;
 
+#if HEVC_STAGE_TIMERS
+    log_stage_timers(s);
+#endif
+
     pic_arrays_free(s);
 
     av_freep(&s->md5_ctx);
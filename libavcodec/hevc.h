@@ -42,6 +42,20 @@
 #define MAX_NB_THREADS 16
 #define SHIFT_CTB_WPP 2
 
+/**
+ * Set to 1 (e.g. with --extra-cflags=-DHEVC_STAGE_TIMERS=1) to measure the
+ * time spent in the main decoding stages with the libavutil/timer.h clock.
+ * The totals are logged in the STOP_TIMER() format when the decoder is
+ * closed, see tools/hevcbench.c.
+ */
+#ifndef HEVC_STAGE_TIMERS
+#define HEVC_STAGE_TIMERS 0
+#endif
+
+#if HEVC_STAGE_TIMERS
+#include "libavutil/timer.h"
+#endif
+
 /**
  * 7.4.2.1
  */
@@ -755,6 +769,26 @@ typedef struct HEVCNAL {
     const uint8_t *data;
 } HEVCNAL;
 
+enum HEVCStage {
+    HEVC_STAGE_CTB,         ///< CTB parsing and reconstruction, includes the stages below
+    HEVC_STAGE_RESIDUAL,    ///< residual coefficient parsing and transform
+    HEVC_STAGE_MC,          ///< inter prediction
+    HEVC_STAGE_DEBLOCK,
+    HEVC_STAGE_SAO,
+    HEVC_STAGE_NB,
+};
+
+#if HEVC_STAGE_TIMERS && defined(AV_READ_TIME)
+#define HEVC_TIMER_START(lc, stage) \
+    ((lc)->stage_start[stage] = AV_READ_TIME())
+#define HEVC_TIMER_STOP(lc, stage) \
+    ((lc)->stage_time[stage] += AV_READ_TIME() - (lc)->stage_start[stage], \
+     (lc)->stage_count[stage]++)
+#else
+#define HEVC_TIMER_START(lc, stage) do { } while (0)
+#define HEVC_TIMER_STOP(lc, stage)  do { } while (0)
+#endif
+
 typedef struct HEVCLocalContext {
     DECLARE_ALIGNED(16, int16_t, mc_buffer[(MAX_PB_SIZE + 7) * MAX_PB_SIZE]);
     uint8_t cabac_state[HEVC_CONTEXTS];
@@ -791,6 +825,12 @@ typedef struct HEVCLocalContext {
 
     uint8_t slice_or_tiles_left_boundary;
     uint8_t slice_or_tiles_up_boundary;
+
+#if HEVC_STAGE_TIMERS
+    uint64_t stage_start[HEVC_STAGE_NB];
+    uint64_t stage_time[HEVC_STAGE_NB];
+    unsigned stage_count[HEVC_STAGE_NB];
+#endif
 } HEVCLocalContext;
 
 typedef struct HEVCContext {
@@ -1093,6 +1093,8 @@ void ff_hevc_hls_residual_coding(HEVCContext *s, int x0, int y0,
     int pred_mode_intra = (c_idx == 0) ? lc->tu.intra_pred_mode :
                                          lc->tu.intra_pred_mode_c;
 
+    HEVC_TIMER_START(lc, HEVC_STAGE_RESIDUAL);
+
     memset(coeffs, 0, trafo_size * trafo_size * sizeof(int16_t));
 
     // Derive QP for dequant
@@ -1559,6 +1561,8 @@ void ff_hevc_hls_residual_coding(HEVCContext *s, int x0, int y0,
         }
     }
     s->hevcdsp.transform_add[log2_trafo_size-2](dst, coeffs, stride);
+
+    HEVC_TIMER_STOP(lc, HEVC_STAGE_RESIDUAL);
 }
 
 void ff_hevc_hls_mvd_coding(HEVCContext *s, int x0, int y0, int log2_cb_size)
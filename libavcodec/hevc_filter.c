@@ -208,6 +208,8 @@ static void sao_filter_CTB(HEVCContext *s, int x, int y)
     uint8_t up_tile_edge     = 0;
     uint8_t bottom_tile_edge = 0;
 
+    HEVC_TIMER_START(s->HEVClc, HEVC_STAGE_SAO);
+
     edges[0]   = x_ctb == 0;
     edges[1]   = y_ctb == 0;
     edges[2]   = x_ctb == s->sps->ctb_width  - 1;
@@ -283,6 +285,8 @@ static void sao_filter_CTB(HEVCContext *s, int x, int y)
             break;
         }
     }
+
+    HEVC_TIMER_STOP(s->HEVClc, HEVC_STAGE_SAO);
 }
 
 static int get_pcm(HEVCContext *s, int x, int y)
@@ -676,7 +680,9 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
 
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size)
 {
+    HEVC_TIMER_START(s->HEVClc, HEVC_STAGE_DEBLOCK);
     deblocking_filter_CTB(s, x, y);
+    HEVC_TIMER_STOP(s->HEVClc, HEVC_STAGE_DEBLOCK);
     if (s->sps->sao_enabled) {
         int x_end = x >= s->sps->width  - ctb_size;
         int y_end = y >= s->sps->height - ctb_size;
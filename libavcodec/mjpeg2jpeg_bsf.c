@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "libavutil/error.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 
 #include "avcodec.h"
@@ -75,6 +76,41 @@ static uint8_t *append_dht_segment(uint8_t *buf)
     return buf;
 }
 
+/* JFIF frames that only lack the DHT segment get it inserted after APP0 */
+static int jfif_add_dht(AVCodecContext *avctx,
+                        uint8_t **poutbuf, int *poutbuf_size,
+                        const uint8_t *buf, int buf_size)
+{
+    int app0_end = AV_RB16(buf + 4) + 4;
+    int pos      = 2;
+    uint8_t *output, *out;
+
+    while (pos + 4 <= buf_size && buf[pos] == 0xff) {
+        if (buf[pos + 1] == DHT) {
+            *poutbuf      = (uint8_t *)buf;
+            *poutbuf_size = buf_size;
+            return 0;
+        }
+        if (buf[pos + 1] == SOS)
+            break;
+        pos += 2 + AV_RB16(buf + pos + 2);
+    }
+    if (buf_size < app0_end) {
+        av_log(avctx, AV_LOG_ERROR, "input is truncated\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    output = out = av_malloc(buf_size + dht_segment_size);
+    if (!output)
+        return AVERROR(ENOMEM);
+    out = append(out, buf, app0_end);
+    out = append_dht_segment(out);
+    out = append(out, buf + app0_end, buf_size - app0_end);
+    *poutbuf      = output;
+    *poutbuf_size = buf_size + dht_segment_size;
+    return 1;
+}
+
 static int mjpeg2jpeg_filter(AVBitStreamFilterContext *bsfc,
                              AVCodecContext *avctx, const char *args,
                              uint8_t **poutbuf, int *poutbuf_size,
@@ -88,6 +124,8 @@ static int mjpeg2jpeg_filter(AVBitStreamFilterContext *bsfc,
         av_log(avctx, AV_LOG_ERROR, "input is truncated\n");
         return AVERROR_INVALIDDATA;
     }
+    if (AV_RB32(buf) == 0xffd8ffe0 && !memcmp("JFIF", buf + 6, 4))
+        return jfif_add_dht(avctx, poutbuf, poutbuf_size, buf, buf_size);
     if (memcmp("AVI1", buf + 6, 4)) {
         av_log(avctx, AV_LOG_ERROR, "input is not MJPEG/AVI1\n");
         return AVERROR_INVALIDDATA;
@@ -69,6 +69,41 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
+static void build_ac_lut(int32_t *lut, const uint8_t *bits_table,
+                         const uint8_t *val_table)
+{
+    uint8_t huff_size[256] = { 0 };
+    uint16_t huff_code[256];
+    int sym;
+
+    memset(lut, 0, sizeof(*lut) << AC_LUT_BITS);
+    ff_mjpeg_build_huffman_codes(huff_size, huff_code, bits_table, val_table);
+
+    for (sym = 0; sym < 256; sym++) {
+        int code_len = huff_size[sym];
+        int size     = sym & 0xf;
+        int len      = code_len + size;
+        int run      = sym ? (sym >> 4) + 1 : 64;
+        int n, prefix;
+
+        if (!code_len || len > AC_LUT_BITS ||
+            huff_code[sym] >= 1 << code_len)
+            continue;
+
+        prefix = huff_code[sym] << (AC_LUT_BITS - code_len);
+        for (n = 0; n < 1 << (AC_LUT_BITS - code_len); n++) {
+            int level = 0;
+
+            if (size) {
+                level = n >> (AC_LUT_BITS - len);
+                if (level < 1 << (size - 1))
+                    level -= (1 << size) - 1;
+            }
+            lut[prefix + n] = level * (1 << 16) | run << 8 | len;
+        }
+    }
+}
+
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
     build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
@@ -83,6 +118,10 @@ static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
               avpriv_mjpeg_val_ac_luminance, 251, 0, 0);
     build_vlc(&s->vlcs[2][1], avpriv_mjpeg_bits_ac_chrominance,
               avpriv_mjpeg_val_ac_chrominance, 251, 0, 0);
+    build_ac_lut(s->ac_lut[0], avpriv_mjpeg_bits_ac_luminance,
+                 avpriv_mjpeg_val_ac_luminance);
+    build_ac_lut(s->ac_lut[1], avpriv_mjpeg_bits_ac_chrominance,
+                 avpriv_mjpeg_val_ac_chrominance);
 }
 
 static void parse_avid(MJpegDecodeContext *s, uint8_t *buf, int len)
@@ -237,6 +276,7 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
             if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
                                  code_max + 1, 0, 0)) < 0)
                 return ret;
+            build_ac_lut(s->ac_lut[index], bits_table, val_table);
         }
     }
     return 0;
@@ -630,6 +670,22 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
     {OPEN_READER(re, &s->gb);
     do {
         UPDATE_CACHE(re, &s->gb);
+        code = s->ac_lut[ac_index][SHOW_UBITS(re, &s->gb, AC_LUT_BITS)];
+        if (code) {
+            SKIP_BITS(re, &s->gb, code & 0xff);
+            i    += (code >> 8) & 0xff;
+            level = code >> 16;
+            if (level) {
+                if (i > 63) {
+                    av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
+                    return AVERROR_INVALIDDATA;
+                }
+                j        = s->scantable.permutated[i];
+                block[j] = level * quant_matrix[j];
+            }
+            continue;
+        }
+
         GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
@@ -676,6 +732,48 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
     return 0;
 }
 
+/* Used with lowres=3, where the IDCT only looks at the DC coefficient:
+ * the AC codes are parsed to stay in sync, but their values are skipped
+ * rather than decoded and dequantized. */
+static int decode_block_dc_only(MJpegDecodeContext *s, int16_t *block,
+                                int component, int dc_index, int ac_index,
+                                int16_t *quant_matrix)
+{
+    int code, i, val;
+
+    val = mjpeg_decode_dc(s, dc_index);
+    if (val == 0xfffff) {
+        av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
+        return AVERROR_INVALIDDATA;
+    }
+    val = val * quant_matrix[0] + s->last_dc[component];
+    s->last_dc[component] = val;
+    block[0] = val;
+
+    i = 0;
+    {OPEN_READER(re, &s->gb);
+    do {
+        UPDATE_CACHE(re, &s->gb);
+        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+
+        i    += ((unsigned)code) >> 4;
+        code &= 0xf;
+        if (code) {
+            if (code > MIN_CACHE_BITS - 16)
+                UPDATE_CACHE(re, &s->gb);
+            LAST_SKIP_BITS(re, &s->gb, code);
+
+            if (i > 63) {
+                av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
+                return AVERROR_INVALIDDATA;
+            }
+        }
+    } while (i < 63);
+    CLOSE_READER(re, &s->gb);}
+
+    return 0;
+}
+
 /* decode block and dequantize - progressive JPEG version */
 static int decode_block_progressive(MJpegDecodeContext *s, int16_t *block,
                                     uint8_t *last_nnz, int ac_index,
@@ -1229,10 +1327,19 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                                              linesize[c], s->avctx->lowres);
 
                         else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                            int16_t *quant_matrix = s->quant_matrixes[s->quant_sindex[i]];
+                            int ret;
+                            if (s->avctx->lowres == 3) {
+                                ret = decode_block_dc_only(s, s->block, i,
+                                                           s->dc_index[i], s->ac_index[i],
+                                                           quant_matrix);
+                            } else {
+                                s->bdsp.clear_block(s->block);
+                                ret = decode_block(s, s->block, i,
+                                                   s->dc_index[i], s->ac_index[i],
+                                                   quant_matrix);
+                            }
+                            if (ret < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
                                        "error y=%d x=%d\n", mb_y, mb_x);
                                 return AVERROR_INVALIDDATA;
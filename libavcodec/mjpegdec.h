@@ -41,6 +41,8 @@
 
 #define MAX_COMPONENTS 4
 
+#define AC_LUT_BITS 11
+
 typedef struct MJpegDecodeContext {
     AVClass *class;
     AVCodecContext *avctx;
@@ -52,6 +54,9 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    /* baseline AC codes whose code and magnitude bits both fit in
+     * AC_LUT_BITS, packed as level << 16 | index increment << 8 | length */
+    int32_t ac_lut[4][1 << AC_LUT_BITS];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
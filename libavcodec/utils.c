@@ -782,6 +782,18 @@ int ff_init_buffer_info(AVCodecContext *avctx, AVFrame *frame)
 
             memcpy(frame_sd->data, packet_sd, size);
         }
+
+#ifdef AD_SIDEDATA
+        /* copy the AD picture header, e.g. for burning in the camera title */
+        packet_sd = av_packet_get_side_data(pkt, AV_PKT_DATA_AD_FRAME, &size);
+        if (packet_sd) {
+            frame_sd = av_frame_new_side_data(frame, AV_FRAME_DATA_AD_FRAME, size);
+            if (!frame_sd)
+                return AVERROR(ENOMEM);
+
+            memcpy(frame_sd->data, packet_sd, size);
+        }
+#endif
     } else {
         frame->pkt_pts = AV_NOPTS_VALUE;
         av_frame_set_pkt_pos     (frame, -1);
@@ -37,6 +37,8 @@
 #endif
 
 static const int desired_video_buffers = 256;
+/* initial number of buffers when more can be added while streaming */
+static const int initial_video_buffers = 8;
 
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
@@ -80,6 +82,13 @@ struct video_data {
     volatile int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
+    int nb_buffers;     /**< Set by a private option. */
+    int max_buffers;    /**< Set by a private option. */
+    int can_create_bufs;
+    int64_t dropped_frames;
+    int64_t copied_frames;
+    uint32_t last_sequence;
+    int sequence_valid;
     char *standard;
     v4l2_std_id std_id;
     int channel;
@@ -330,16 +339,76 @@ static void list_standards(AVFormatContext *ctx)
     }
 }
 
+static int mmap_buffer(AVFormatContext *ctx, int i)
+{
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_buffer buf = {
+        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .index  = i,
+        .memory = V4L2_MEMORY_MMAP
+    };
+    int res;
+
+    if (v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF): %s\n", av_err2str(res));
+        return res;
+    }
+
+    s->buf_len[i] = buf.length;
+    if (s->frame_size > 0 && s->buf_len[i] < s->frame_size) {
+        av_log(ctx, AV_LOG_ERROR,
+               "buf_len[%d] = %d < expected frame size %d\n",
+               i, s->buf_len[i], s->frame_size);
+        return AVERROR(ENOMEM);
+    }
+    s->buf_start[i] = v4l2_mmap(NULL, buf.length,
+                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                           s->fd, buf.m.offset);
+
+    if (s->buf_start[i] == MAP_FAILED) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Check whether buffers can be added with VIDIOC_CREATE_BUFS once
+ * streaming has started. A zero count only validates the request.
+ */
+static int probe_create_bufs(struct video_data *s)
+{
+    struct v4l2_create_buffers create = {
+        .count  = 0,
+        .memory = V4L2_MEMORY_MMAP,
+        .format = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE }
+    };
+
+    if (v4l2_ioctl(s->fd, VIDIOC_G_FMT, &create.format) < 0)
+        return 0;
+    return v4l2_ioctl(s->fd, VIDIOC_CREATE_BUFS, &create) >= 0;
+}
+
 static int mmap_init(AVFormatContext *ctx)
 {
     int i, res;
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
         .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .count  = desired_video_buffers,
+        .count  = s->nb_buffers ? s->nb_buffers : desired_video_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
 
+    /* start with a few buffers and add more when the caller holds on to
+     * them, rather than falling back to copying frames */
+    if (!s->nb_buffers && !s->use_libv4l2 && probe_create_bufs(s)) {
+        s->can_create_bufs = 1;
+        req.count = FFMIN(initial_video_buffers, s->max_buffers);
+    }
+
     if (v4l2_ioctl(s->fd, VIDIOC_REQBUFS, &req) < 0) {
         res = AVERROR(errno);
         av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_REQBUFS): %s\n", av_err2str(res));
@@ -363,37 +432,83 @@ static int mmap_init(AVFormatContext *ctx)
         return AVERROR(ENOMEM);
     }
 
-    for (i = 0; i < req.count; i++) {
+    for (i = 0; i < req.count; i++)
+        if ((res = mmap_buffer(ctx, i)) < 0)
+            return res;
+
+    return 0;
+}
+
+/**
+ * Add buffers to the queue while streaming, doubling their number up to
+ * max_buffers. On failure, buffers are not added anymore.
+ */
+static int mmap_add_buffers(AVFormatContext *ctx)
+{
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_create_buffers create = {
+        .count  = FFMIN(s->buffers, s->max_buffers - s->buffers),
+        .memory = V4L2_MEMORY_MMAP,
+        .format = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE }
+    };
+    void **buf_start;
+    unsigned int *buf_len;
+    int i, res;
+
+    if (create.count <= 0) {
+        s->can_create_bufs = 0;
+        return AVERROR(ENOMEM);
+    }
+
+    if (v4l2_ioctl(s->fd, VIDIOC_G_FMT, &create.format) < 0 ||
+        v4l2_ioctl(s->fd, VIDIOC_CREATE_BUFS, &create) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_WARNING, "ioctl(VIDIOC_CREATE_BUFS): %s\n", av_err2str(res));
+        s->can_create_bufs = 0;
+        return res;
+    }
+    /* the new buffers must follow the existing ones */
+    if (create.index != s->buffers || !create.count) {
+        s->can_create_bufs = 0;
+        return AVERROR(ENOMEM);
+    }
+
+    buf_start = av_realloc_array(s->buf_start, s->buffers + create.count, sizeof(*buf_start));
+    if (!buf_start)
+        goto fail;
+    s->buf_start = buf_start;
+    buf_len = av_realloc_array(s->buf_len, s->buffers + create.count, sizeof(*buf_len));
+    if (!buf_len)
+        goto fail;
+    s->buf_len = buf_len;
+
+    for (i = s->buffers; i < create.index + create.count; i++) {
         struct v4l2_buffer buf = {
             .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
             .index  = i,
             .memory = V4L2_MEMORY_MMAP
         };
-        if (v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            res = AVERROR(errno);
-            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF): %s\n", av_err2str(res));
-            return res;
-        }
 
-        s->buf_len[i] = buf.length;
-        if (s->frame_size > 0 && s->buf_len[i] < s->frame_size) {
-            av_log(ctx, AV_LOG_ERROR,
-                   "buf_len[%d] = %d < expected frame size %d\n",
-                   i, s->buf_len[i], s->frame_size);
-            return AVERROR(ENOMEM);
+        if ((res = mmap_buffer(ctx, i)) < 0) {
+            s->can_create_bufs = 0;
+            return res;
         }
-        s->buf_start[i] = v4l2_mmap(NULL, buf.length,
-                               PROT_READ | PROT_WRITE, MAP_SHARED,
-                               s->fd, buf.m.offset);
-
-        if (s->buf_start[i] == MAP_FAILED) {
+        if (v4l2_ioctl(s->fd, VIDIOC_QBUF, &buf) < 0) {
             res = AVERROR(errno);
-            av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
+            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n", av_err2str(res));
+            v4l2_munmap(s->buf_start[i], s->buf_len[i]);
+            s->can_create_bufs = 0;
             return res;
         }
+        s->buffers++;
+        avpriv_atomic_int_add_and_fetch(&s->buffers_queued, 1);
     }
+    av_log(ctx, AV_LOG_VERBOSE, "Using %d buffers\n", s->buffers);
 
     return 0;
+fail:
+    s->can_create_bufs = 0;
+    return AVERROR(ENOMEM);
 }
 
 #if FF_API_DESTRUCT_PACKET
@@ -514,6 +629,11 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     // always keep at least one buffer queued
     av_assert0(avpriv_atomic_int_get(&s->buffers_queued) >= 1);
 
+    if (s->sequence_valid && buf.sequence - s->last_sequence - 1 < 0x80000000U)
+        s->dropped_frames += buf.sequence - s->last_sequence - 1;
+    s->last_sequence  = buf.sequence;
+    s->sequence_valid = 1;
+
     /* CPIA is a compressed format and we don't know the exact number of bytes
      * used by a frame, so set it here as the driver announces it.
      */
@@ -528,7 +648,10 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     }
 
     /* Image is at s->buff_start[buf.index] */
-    if (avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1) &&
+        s->can_create_bufs)
+        mmap_add_buffers(ctx);
+    if (avpriv_atomic_int_get(&s->buffers_queued) <= FFMAX(s->buffers / 8, 1)) {
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -546,6 +669,7 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
             return res;
         }
         avpriv_atomic_int_add_and_fetch(&s->buffers_queued, 1);
+        s->copied_frames++;
     } else {
         struct buff_data *buf_descriptor;
 
@@ -980,6 +1104,8 @@ static int v4l2_read_close(AVFormatContext *s1)
     if (avpriv_atomic_int_get(&s->buffers_queued) != s->buffers)
         av_log(s1, AV_LOG_WARNING, "Some buffers are still owned by the caller on "
                "close.\n");
+    av_log(s1, AV_LOG_VERBOSE, "%"PRId64" frames dropped, %"PRId64" frames copied, "
+           "%d buffers\n", s->dropped_frames, s->copied_frames, s->buffers);
 
     mmap_close(s);
 
@@ -1012,6 +1138,10 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_INT,    {.i64 = 0}, 0, 1, DEC },
+    { "buffers",      "set number of capture buffers, 0 to adapt it to the caller", OFFSET(nb_buffers),   AV_OPT_TYPE_INT,    {.i64 = 0}, 0, 256, DEC },
+    { "max_buffers",  "set maximum number of capture buffers when adapting it",   OFFSET(max_buffers),  AV_OPT_TYPE_INT,    {.i64 = 32}, 2, 256, DEC },
+    { "dropped_frames", "number of frames dropped by the driver",                 OFFSET(dropped_frames), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, DEC|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "copied_frames",  "number of frames copied because few buffers were left",  OFFSET(copied_frames),  AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, DEC|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
     { NULL },
 };
 
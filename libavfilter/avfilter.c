@@ -31,11 +31,13 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 
 static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame);
 
@@ -332,19 +334,61 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
+static int64_t *timing_nested(AVFilterContext *ctx)
+{
+    if (ctx->internal->time_nested)
+        return ctx->internal->time_nested;
+    return &ctx->graph->internal->time_nested;
+}
+
+static int64_t timing_begin(AVFilterContext *ctx, int64_t *saved_nested)
+{
+    int64_t *nested = timing_nested(ctx);
+
+    *saved_nested = *nested;
+    *nested       = 0;
+    return av_gettime_relative();
+}
+
+/**
+ * Account the time elapsed since timing_begin() to ctx, minus the time spent
+ * in the callbacks of other filters it called in the meantime.
+ */
+static void timing_end(AVFilterContext *ctx, int64_t start, int64_t saved_nested)
+{
+    int64_t *nested = timing_nested(ctx);
+    int64_t elapsed = av_gettime_relative() - start;
+
+    ctx->internal->time_self += elapsed - *nested;
+    ctx->internal->nb_timed_calls++;
+    *nested = saved_nested + elapsed;
+}
+
+static int timing_enabled(AVFilterContext *ctx)
+{
+    return ctx->graph && ctx->graph->timing;
+}
+
 int ff_request_frame(AVFilterLink *link)
 {
     int ret = -1;
     FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
 
+    if (link->branch && ff_branch_crossing(link, 1))
+        return ff_branch_request_frame(link);
     if (link->closed)
         return AVERROR_EOF;
     av_assert0(!link->frame_requested);
     link->frame_requested = 1;
     while (link->frame_requested) {
-        if (link->srcpad->request_frame)
-            ret = link->srcpad->request_frame(link);
-        else if (link->src->inputs[0])
+        if (link->srcpad->request_frame) {
+            if (timing_enabled(link->src)) {
+                int64_t nested, start = timing_begin(link->src, &nested);
+                ret = link->srcpad->request_frame(link);
+                timing_end(link->src, start, nested);
+            } else
+                ret = link->srcpad->request_frame(link);
+        } else if (link->src->inputs[0])
             ret = ff_request_frame(link->src->inputs[0]);
         if (ret == AVERROR_EOF && link->partial_buf) {
             AVFrame *pbuf = link->partial_buf;
@@ -1004,7 +1048,9 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     AVFilterCommand *cmd= link->dst->command_queue;
     int64_t pts;
 
-    if (link->closed) {
+    /* the head of a branch is closed before the branch has filtered all
+     * the frames queued on it, the branch tracks EOF itself */
+    if (link->closed && !link->branch) {
         av_frame_free(&frame);
         return AVERROR_EOF;
     }
@@ -1078,9 +1124,15 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
             (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
             filter_frame = default_filter_frame;
     }
-    ret = filter_frame(link, out);
+    if (timing_enabled(dstctx)) {
+        int64_t nested, start = timing_begin(dstctx, &nested);
+        ret = filter_frame(link, out);
+        timing_end(dstctx, start, nested);
+    } else
+        ret = filter_frame(link, out);
     link->frame_count++;
-    link->frame_requested = 0;
+    if (!link->branch)
+        link->frame_requested = 0;
     ff_update_link_current_pts(link, pts);
     return ret;
 
@@ -1150,6 +1202,9 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_assert1(frame->sample_rate           == link->sample_rate);
     }
 
+    if (link->branch && ff_branch_crossing(link, 0))
+        return ff_branch_filter_frame(link, frame);
+
     /* Go directly to actual filtering if possible */
     if (link->type == AVMEDIA_TYPE_AUDIO &&
         link->min_samples &&
@@ -860,6 +860,12 @@ struct AVFilterLink {
      * Number of past frames sent through the link.
      */
     int64_t frame_count;
+
+    /**
+     * Branch running in its own thread this link enters or leaves, if any.
+     * Used internally by the framework.
+     */
+    struct AVFilterBranch *branch;
 };
 
 /**
@@ -1241,6 +1247,20 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * If nonzero, measure the time spent inside each filter of the graph and
+     * log a per-filter summary when the graph is freed.
+     * Access ONLY through AVOptions.
+     */
+    int timing;
+
+    /**
+     * If nonzero, run each chain of filters going from a source to an input
+     * of a multi-input video filter in its own thread.
+     * Access ONLY through AVOptions.
+     */
+    int branch_threads;
 } AVFilterGraph;
 
 /**
@@ -45,6 +45,10 @@ static const AVOption filtergraph_options[] = {
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "timing",      "Log the time spent in each filter", OFFSET(timing),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, 1, FLAGS },
+    { "branch_threads", "Run the branches feeding multi-input filters in their own threads", OFFSET(branch_threads),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, 1, FLAGS },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -71,6 +75,30 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_branches_init(AVFilterGraph *graph)
+{
+    return 0;
+}
+
+void ff_graph_branches_free(AVFilterGraph *graph)
+{
+}
+
+int ff_branch_crossing(AVFilterLink *link, int request)
+{
+    return 0;
+}
+
+int ff_branch_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_branch_request_frame(AVFilterLink *link)
+{
+    return AVERROR(ENOSYS);
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -104,11 +132,33 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
     }
 }
 
+static void log_filter_timing(AVFilterGraph *graph)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f   = graph->filters[i];
+        AVFilterInternal *fi = f->internal;
+
+        if (!fi->nb_timed_calls)
+            continue;
+        av_log(f, AV_LOG_INFO,
+               "%"PRId64" calls, %"PRId64" us total, %"PRId64" us/call\n",
+               fi->nb_timed_calls, fi->time_self,
+               fi->time_self / fi->nb_timed_calls);
+    }
+}
+
 void avfilter_graph_free(AVFilterGraph **graph)
 {
     if (!*graph)
         return;
 
+    ff_graph_branches_free(*graph);
+
+    if ((*graph)->timing)
+        log_filter_timing(*graph);
+
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
@@ -1197,6 +1247,9 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = ff_avfilter_graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if (graphctx->branch_threads &&
+        (ret = ff_graph_branches_init(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
@@ -21,6 +21,7 @@
 
 #include <string.h>
 
+#include "config.h"
 #include "libavutil/avutil.h"
 #include "libavutil/colorspace.h"
 #include "libavutil/mem.h"
@@ -185,6 +186,8 @@ int ff_draw_init(FFDrawContext *draw, enum AVPixelFormat format, unsigned flags)
     for (i = 0; i < ((desc->nb_components - 1) | 1); i++)
         draw->comp_mask[desc->comp[i].plane] |=
             1 << (desc->comp[i].offset_plus1 - 1);
+    if (ARCH_X86)
+        ff_draw_init_x86(draw);
     return 0;
 }
 
@@ -418,7 +421,92 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
-static void blend_line_hv(uint8_t *dst, int dst_delta,
+static av_always_inline void blend_pixel8(uint8_t *dst, unsigned src,
+                                          unsigned alpha, const uint8_t *mask,
+                                          int mask_linesize, unsigned w,
+                                          unsigned h, unsigned shift)
+{
+    unsigned x, y, t = 0;
+
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++)
+            t += mask[x];
+        mask += mask_linesize;
+    }
+    /* a transparent mask leaves the pixel unchanged, skip the store */
+    if (!t)
+        return;
+    alpha = (t >> shift) * alpha;
+    *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
+}
+
+/**
+ * Same as blend_line_hv() for 8-bit masks, with the bit unpacking taken out
+ * of the inner loop. Glyph masks are mostly transparent, the pixels where
+ * the mask is 0 are not written.
+ */
+static void blend_line_hv8(FFDrawContext *draw, uint8_t *dst, int dst_delta,
+                           unsigned src, unsigned alpha,
+                           const uint8_t *mask, int mask_linesize, int w,
+                           unsigned hsub, unsigned vsub,
+                           int xm, int left, int right, int hband)
+{
+    int x;
+
+    mask += xm;
+    if (!hsub && !vsub) {
+        x = 0;
+        if (dst_delta == 1 && draw->blend_row8) {
+            x = w & ~3;
+            draw->blend_row8(dst, mask, x, src, alpha);
+            dst += x;
+        }
+        for (; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+    if (hsub == 1 && hband == 2 && !left && !right) {
+        const uint8_t *mask2 = mask + mask_linesize;
+        x = 0;
+        if (dst_delta == 1 && draw->blend_row8_2x2) {
+            x = w & ~3;
+            draw->blend_row8_2x2(dst, mask, mask_linesize, x,
+                                 src, alpha, 1 + vsub);
+            dst += x;
+        }
+        for (; x < w; x++) {
+            unsigned t = mask[2 * x] + mask[2 * x + 1] + mask2[2 * x] + mask2[2 * x + 1];
+            if (t) {
+                unsigned a = (t >> (1 + vsub)) * alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+    if (left) {
+        blend_pixel8(dst, src, alpha, mask, mask_linesize,
+                     left, hband, hsub + vsub);
+        dst  += dst_delta;
+        mask += left;
+    }
+    for (x = 0; x < w; x++) {
+        blend_pixel8(dst, src, alpha, mask, mask_linesize,
+                     1 << hsub, hband, hsub + vsub);
+        dst  += dst_delta;
+        mask += 1 << hsub;
+    }
+    if (right)
+        blend_pixel8(dst, src, alpha, mask, mask_linesize,
+                     right, hband, hsub + vsub);
+}
+
+static void blend_line_hv(FFDrawContext *draw, uint8_t *dst, int dst_delta,
                           unsigned src, unsigned alpha,
                           uint8_t *mask, int mask_linesize, int l2depth, int w,
                           unsigned hsub, unsigned vsub,
@@ -426,6 +514,11 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3) {
+        blend_line_hv8(draw, dst, dst_delta, src, alpha, mask, mask_linesize,
+                       w, hsub, vsub, xm, left, right, hband);
+        return;
+    }
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
@@ -476,7 +569,7 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
             p = p0 + comp;
             m = mask;
             if (top) {
-                blend_line_hv(p, draw->pixelstep[plane],
+                blend_line_hv(draw, p, draw->pixelstep[plane],
                               color->comp[plane].u8[comp], alpha,
                               m, mask_linesize, l2depth, w_sub,
                               draw->hsub[plane], draw->vsub[plane],
@@ -485,7 +578,7 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                 m += top * mask_linesize;
             }
             for (y = 0; y < h_sub; y++) {
-                blend_line_hv(p, draw->pixelstep[plane],
+                blend_line_hv(draw, p, draw->pixelstep[plane],
                               color->comp[plane].u8[comp], alpha,
                               m, mask_linesize, l2depth, w_sub,
                               draw->hsub[plane], draw->vsub[plane],
@@ -494,7 +587,7 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                 m += mask_linesize << draw->vsub[plane];
             }
             if (bottom)
-                blend_line_hv(p, draw->pixelstep[plane],
+                blend_line_hv(draw, p, draw->pixelstep[plane],
                               color->comp[plane].u8[comp], alpha,
                               m, mask_linesize, l2depth, w_sub,
                               draw->hsub[plane], draw->vsub[plane],
@@ -55,6 +55,22 @@ typedef struct FFDrawContext {
     uint8_t vsub[MAX_PLANES];  /*< vertical subsampling */
     uint8_t hsub_max;
     uint8_t vsub_max;
+
+    /**
+     * Blend w pixels of a plane that is not subsampled with a row of an
+     * 8-bit mask. w is a multiple of 4, alpha as in ff_blend_mask().
+     * NULL if there is no optimized version.
+     */
+    void (*blend_row8)(uint8_t *dst, const uint8_t *mask, int w,
+                       unsigned src, unsigned alpha);
+
+    /**
+     * Same as blend_row8() for a plane subsampled 2x2, each pixel is
+     * blended with the sum of 4 mask samples shifted right by shift.
+     */
+    void (*blend_row8_2x2)(uint8_t *dst, const uint8_t *mask,
+                           ptrdiff_t mask_linesize, int w,
+                           unsigned src, unsigned alpha, int shift);
 } FFDrawContext;
 
 typedef struct FFDrawColor {
@@ -76,6 +92,8 @@ typedef struct FFDrawColor {
  */
 int ff_draw_init(FFDrawContext *draw, enum AVPixelFormat format, unsigned flags);
 
+void ff_draw_init_x86(FFDrawContext *draw);
+
 /**
  * Prepare a color.
  */
@@ -155,10 +155,16 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+    int64_t time_nested;        ///< time spent in nested filter callbacks, used for timing
+    struct AVFilterBranch **branches;
+    int nb_branches;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    int64_t time_self;          ///< time spent in this filter only, excluding downstream filters
+    int64_t nb_timed_calls;     ///< number of timed request_frame/filter_frame calls
+    int64_t *time_nested;       ///< nested time of the thread running this filter, graph's if NULL
 };
 
 #if FF_API_AVFILTERBUFFER
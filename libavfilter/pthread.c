@@ -26,7 +26,9 @@
 
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
+#include "libavutil/fifo.h"
 #include "libavutil/mem.h"
+#include "libavutil/time.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -57,6 +59,7 @@ typedef struct ThreadContext {
     pthread_cond_t last_job_cond;
     pthread_cond_t current_job_cond;
     pthread_mutex_t current_job_lock;
+    pthread_mutex_t execute_lock;   ///< serializes callers running in different branches
     int current_job;
     unsigned int current_execute;
     int done;
@@ -109,6 +112,7 @@ static void slice_thread_uninit(ThreadContext *c)
          pthread_join(c->workers[i], NULL);
 
     pthread_mutex_destroy(&c->current_job_lock);
+    pthread_mutex_destroy(&c->execute_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
     av_freep(&c->workers);
@@ -130,6 +134,7 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     if (nb_jobs <= 0)
         return 0;
 
+    pthread_mutex_lock(&c->execute_lock);
     pthread_mutex_lock(&c->current_job_lock);
 
     c->current_job = c->nb_threads;
@@ -149,6 +154,7 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     pthread_cond_broadcast(&c->current_job_cond);
 
     slice_thread_park_workers(c);
+    pthread_mutex_unlock(&c->execute_lock);
 
     return 0;
 }
@@ -182,6 +188,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
     pthread_cond_init(&c->last_job_cond,    NULL);
 
     pthread_mutex_init(&c->current_job_lock, NULL);
+    pthread_mutex_init(&c->execute_lock, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i = 0; i < nb_threads; i++) {
         ret = pthread_create(&c->workers[i], NULL, worker, c);
@@ -235,3 +242,303 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+/**
+ * A chain of single input, single output filters going from a source to an
+ * input of a multi-input filter, run in its own thread. The source and the
+ * multi-input filter stay in the caller's thread; frames are queued on the
+ * two links crossing the threads.
+ */
+typedef struct AVFilterBranch {
+    AVFilterLink *head;         ///< link from the source into the branch
+    AVFilterLink *tail;         ///< link from the branch into the multi-input filter
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    AVFifoBuffer *in;           ///< frames sent on head, not filtered yet
+    AVFifoBuffer *out;          ///< frames sent on tail, not delivered yet
+    int busy;                   ///< the worker is running filters
+    int request;                ///< the worker must request a frame on tail
+    int eof;                    ///< the source returned EOF
+    int status;                 ///< AVERROR_EOF once flushed, or branch error
+    int quit;
+    int64_t time_nested;        ///< nested time of the worker, used for timing
+} AVFilterBranch;
+
+static int branch_is_worker(AVFilterBranch *b)
+{
+    return pthread_equal(pthread_self(), b->thread);
+}
+
+static int branch_queue_frame(AVFifoBuffer **fifo, AVFrame *frame)
+{
+    int ret;
+
+    if (av_fifo_space(*fifo) < sizeof(frame) &&
+        (ret = av_fifo_realloc2(*fifo, 2 * av_fifo_size(*fifo))) < 0)
+        return ret;
+    av_fifo_generic_write(*fifo, &frame, sizeof(frame), NULL);
+    return 0;
+}
+
+static void branch_empty_fifo(AVFifoBuffer *fifo)
+{
+    AVFrame *frame;
+
+    while (av_fifo_size(fifo) >= sizeof(frame)) {
+        av_fifo_generic_read(fifo, &frame, sizeof(frame), NULL);
+        av_frame_free(&frame);
+    }
+}
+
+static void* attribute_align_arg branch_worker(void *v)
+{
+    AVFilterBranch *b = v;
+    AVFilterLink *tail = b->tail;
+    AVFrame *frame;
+    int ret;
+
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        while (!b->quit && !av_fifo_size(b->in) && !b->request)
+            pthread_cond_wait(&b->cond, &b->lock);
+        if (b->quit)
+            break;
+
+        b->busy = 1;
+        if (av_fifo_size(b->in)) {
+            av_fifo_generic_read(b->in, &frame, sizeof(frame), NULL);
+            pthread_mutex_unlock(&b->lock);
+            ret = ff_filter_frame(b->head, frame);
+            pthread_mutex_lock(&b->lock);
+        } else {
+            pthread_mutex_unlock(&b->lock);
+            if (tail->srcpad->request_frame)
+                ret = tail->srcpad->request_frame(tail);
+            else
+                ret = ff_request_frame(tail->src->inputs[0]);
+            pthread_mutex_lock(&b->lock);
+            b->request = 0;
+            if (ret == AVERROR(EAGAIN))
+                ret = 0;
+        }
+        if (ret < 0 && !b->status)
+            b->status = ret;
+        b->busy = 0;
+        pthread_cond_broadcast(&b->cond);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+/**
+ * Wait for the worker, counting the time waited as spent in other filters.
+ */
+static void branch_wait(AVFilterBranch *b)
+{
+    AVFilterGraph *graph = b->tail->dst->graph;
+
+    if (graph->timing) {
+        int64_t start = av_gettime_relative();
+        pthread_cond_wait(&b->cond, &b->lock);
+        graph->internal->time_nested += av_gettime_relative() - start;
+    } else
+        pthread_cond_wait(&b->cond, &b->lock);
+}
+
+int ff_branch_crossing(AVFilterLink *link, int request)
+{
+    AVFilterBranch *b = link->branch;
+
+    /* the worker runs the destination of head and the source of tail */
+    return branch_is_worker(b) == (request ? link == b->head : link == b->tail);
+}
+
+int ff_branch_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    AVFilterBranch *b = link->branch;
+    int ret;
+
+    pthread_mutex_lock(&b->lock);
+    if (link == b->head && b->status < 0)
+        ret = b->status;
+    else
+        ret = branch_queue_frame(link == b->head ? &b->in : &b->out, frame);
+    if (ret >= 0)
+        pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+
+    if (ret < 0)
+        av_frame_free(&frame);
+    if (link == b->head)
+        link->frame_requested = 0;
+    return ret;
+}
+
+int ff_branch_request_frame(AVFilterLink *link)
+{
+    AVFilterBranch *b = link->branch;
+    AVFrame *frame;
+    int requested = 0, ret;
+
+    if (link == b->head) {
+        /* a filter of the branch wants input: the caller's thread provides it */
+        pthread_mutex_lock(&b->lock);
+        ret = b->eof ? AVERROR_EOF : AVERROR(EAGAIN);
+        pthread_mutex_unlock(&b->lock);
+        return ret;
+    }
+
+    if (link->closed)
+        return AVERROR_EOF;
+
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        if (av_fifo_size(b->out)) {
+            av_fifo_generic_read(b->out, &frame, sizeof(frame), NULL);
+            pthread_mutex_unlock(&b->lock);
+            return ff_filter_frame(link, frame);
+        }
+        if (b->busy || b->request || av_fifo_size(b->in)) {
+            branch_wait(b);
+            continue;
+        }
+        if (b->status < 0) {
+            ret = b->status;
+            break;
+        }
+        if (!requested) {
+            b->request = requested = 1;
+            pthread_cond_broadcast(&b->cond);
+            continue;
+        }
+
+        /* the branch returned nothing without more input */
+        pthread_mutex_unlock(&b->lock);
+        ret = ff_request_frame(b->head);
+        pthread_mutex_lock(&b->lock);
+        if (ret == AVERROR_EOF)
+            b->eof = 1;
+        else if (ret < 0)
+            break;
+        requested = 0;
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    if (ret == AVERROR_EOF)
+        link->closed = 1;
+    return ret;
+}
+
+static int branch_start(AVFilterGraph *graph, AVFilterLink *head, AVFilterLink *tail)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVFilterBranch *b, **branches;
+    AVFilterLink *link;
+    int ret;
+
+    branches = av_realloc_array(gi->branches, gi->nb_branches + 1, sizeof(*branches));
+    if (!branches)
+        return AVERROR(ENOMEM);
+    gi->branches = branches;
+
+    b = av_mallocz(sizeof(*b));
+    if (!b)
+        return AVERROR(ENOMEM);
+    b->head = head;
+    b->tail = tail;
+    b->in   = av_fifo_alloc(16 * sizeof(AVFrame *));
+    b->out  = av_fifo_alloc(16 * sizeof(AVFrame *));
+    if (!b->in || !b->out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->cond, NULL);
+    if ((ret = pthread_create(&b->thread, NULL, branch_worker, b))) {
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->cond);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+
+    for (link = tail; link != head; link = link->src->inputs[0])
+        link->src->internal->time_nested = &b->time_nested;
+    head->branch = tail->branch = b;
+    gi->branches[gi->nb_branches++] = b;
+
+    av_log(graph, AV_LOG_VERBOSE, "Running '%s' to '%s' in its own thread\n",
+           head->dst->name, tail->src->name);
+    return 0;
+
+fail:
+    av_fifo_free(b->in);
+    av_fifo_free(b->out);
+    av_free(b);
+    return ret;
+}
+
+int ff_graph_branches_init(AVFilterGraph *graph)
+{
+    int i, j, ret;
+
+#if HAVE_W32THREADS
+    w32thread_init();
+#endif
+
+    if (graph->internal->nb_branches)
+        return 0;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (filter->nb_inputs < 2)
+            continue;
+        for (j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *tail = filter->inputs[j], *head = NULL;
+            AVFilterContext *f = tail->src;
+
+            while (f->nb_inputs == 1 && f->nb_outputs == 1) {
+                head = f->inputs[0];
+                f    = head->src;
+            }
+            if (!head || f->nb_inputs || f->nb_outputs != 1 ||
+                head->type != AVMEDIA_TYPE_VIDEO ||
+                tail->type != AVMEDIA_TYPE_VIDEO)
+                continue;
+            if ((ret = branch_start(graph, head, tail)) < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+void ff_graph_branches_free(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVFilterLink *link;
+    int i;
+
+    for (i = 0; i < gi->nb_branches; i++) {
+        AVFilterBranch *b = gi->branches[i];
+
+        pthread_mutex_lock(&b->lock);
+        b->quit = 1;
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+        pthread_join(b->thread, NULL);
+
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->cond);
+        branch_empty_fifo(b->in);
+        branch_empty_fifo(b->out);
+        av_fifo_free(b->in);
+        av_fifo_free(b->out);
+        for (link = b->tail; link != b->head; link = link->src->inputs[0])
+            link->src->internal->time_nested = NULL;
+        b->head->branch = b->tail->branch = NULL;
+        av_free(b);
+    }
+    av_freep(&gi->branches);
+    gi->nb_branches = 0;
+}
@@ -26,4 +26,30 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start a worker thread for each chain of single input, single output video
+ * filters which runs from a source to an input of a multi-input filter.
+ */
+int ff_graph_branches_init(AVFilterGraph *graph);
+
+void ff_graph_branches_free(AVFilterGraph *graph);
+
+/**
+ * Check whether link, which enters or leaves a branch, must be crossed to
+ * another thread by the calling thread.
+ *
+ * @param request nonzero for a frame request, zero for a frame sent on link
+ */
+int ff_branch_crossing(AVFilterLink *link, int request);
+
+/**
+ * Hand a frame sent on a crossing link over to the thread on the other side.
+ */
+int ff_branch_filter_frame(AVFilterLink *link, AVFrame *frame);
+
+/**
+ * Request a frame on a crossing link, waiting for the branch if needed.
+ */
+int ff_branch_request_frame(AVFilterLink *link);
+
 #endif /* AVFILTER_THREAD_H */
@@ -46,6 +46,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/common.h"
 #include "libavutil/file.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/eval.h"
 #include "libavutil/opt.h"
 #include "libavutil/random_seed.h"
@@ -145,6 +146,9 @@ typedef struct DrawTextContext {
     int ft_load_flags;              ///< flags used for loading fonts, see FT_LOAD_*
     FT_Vector *positions;           ///< positions for each element in the text
     size_t nb_positions;            ///< number of elements of positions array
+    struct Glyph **text_glyphs;     ///< glyph for each element in the text, NULL if not drawn
+    int nb_text_glyphs;             ///< number of elements in the laid out text
+    char *layout_text;              ///< text the positions were computed for
     char *textfile;                 ///< file with text to be drawn
     int x;                          ///< x position to start drawing text
     int y;                          ///< y position to start drawing text
@@ -190,8 +194,19 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+    const uint8_t *ad_pic;          ///< AD picture header of the current frame
 } DrawTextContext;
 
+/* fields of the AV_FRAME_DATA_AD_FRAME video header, see libavutil/frame.h */
+#define AD_PIC_CAM          8
+#define AD_PIC_SESSION_TIME 44
+#define AD_PIC_MILLISECONDS 48
+#define AD_PIC_TITLE        56
+#define AD_PIC_ALARM        87
+#define AD_PIC_UTC_OFFSET   160
+#define AD_PIC_SIZE         168
+#define AD_PIC_TEXT_SIZE    31
+
 #define OFFSET(x) offsetof(DrawTextContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 
@@ -713,7 +728,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     s->x_pexpr = s->y_pexpr = s->draw_pexpr = NULL;
 #endif
     av_freep(&s->positions);
+    av_freep(&s->text_glyphs);
     s->nb_positions = 0;
+    av_freep(&s->layout_text);
 
 
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
@@ -888,6 +905,39 @@ static int func_strftime(AVFilterContext *ctx, AVBPrint *bp,
     return 0;
 }
 
+static int func_ad(AVFilterContext *ctx, AVBPrint *bp,
+                   char *fct, unsigned argc, char **argv, int tag)
+{
+    DrawTextContext *s = ctx->priv;
+    const uint8_t *pic = s->ad_pic;
+
+    if (!pic)
+        return 0;
+    if (!strcmp(argv[0], "title")) {
+        av_bprintf(bp, "%.*s", AD_PIC_TEXT_SIZE, pic + AD_PIC_TITLE);
+    } else if (!strcmp(argv[0], "alarm")) {
+        av_bprintf(bp, "%.*s", AD_PIC_TEXT_SIZE, pic + AD_PIC_ALARM);
+    } else if (!strcmp(argv[0], "camera")) {
+        av_bprintf(bp, "%d", (int32_t)AV_RN32(pic + AD_PIC_CAM));
+    } else if (!strcmp(argv[0], "time") || !strcmp(argv[0], "gmtime")) {
+        const char *fmt = argc > 1 ? argv[1] : "%Y-%m-%d %H:%M:%S";
+        time_t t = AV_RN32(pic + AD_PIC_SESSION_TIME);
+        struct tm tm;
+
+        /* the camera local time is UTC plus the offset sent by the camera */
+        if (argv[0][0] == 't')
+            t += (int32_t)AV_RN32(pic + AD_PIC_UTC_OFFSET) * 60;
+        tm = *gmtime(&t);
+        av_bprint_strftime(bp, fmt, &tm);
+    } else if (!strcmp(argv[0], "msec")) {
+        av_bprintf(bp, "%03d", (int)(AV_RN32(pic + AD_PIC_MILLISECONDS) % 1000));
+    } else {
+        av_log(ctx, AV_LOG_ERROR, "Unknown AD field '%s'\n", argv[0]);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
 static int func_eval_expr(AVFilterContext *ctx, AVBPrint *bp,
                           char *fct, unsigned argc, char **argv, int tag)
 {
@@ -923,6 +973,7 @@ static const struct drawtext_function {
     { "frame_num", 0, 0, 0,   func_frame_num },
     { "n",         0, 0, 0,   func_frame_num },
     { "metadata",  1, 1, 0,   func_metadata },
+    { "ad",        1, 2, 0,   func_ad       },
 };
 
 static int eval_function(AVFilterContext *ctx, AVBPrint *bp, char *fct,
@@ -1018,28 +1069,19 @@ static int expand_text(AVFilterContext *ctx)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
+static int draw_glyphs(DrawTextContext *s, uint8_t *data[4], int linesize[4],
                        int width, int height,
                        FFDrawColor *color, int x, int y, int borderw)
 {
-    char *text = s->expanded_text.str;
-    uint32_t code = 0;
     int i, x1, y1;
-    uint8_t *p;
-    Glyph *glyph = NULL;
 
-    for (i = 0, p = text; *p; i++) {
+    for (i = 0; i < s->nb_text_glyphs; i++) {
+        const Glyph *glyph = s->text_glyphs[i];
         FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p++, continue;);
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (!glyph)
             continue;
 
-        dummy.code = code;
-        glyph = av_tree_find(s->glyphs, &dummy, (void *)glyph_cmp, NULL);
-
         bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
@@ -1050,7 +1092,7 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         y1 = s->positions[i].y+s->y+y - borderw;
 
         ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
+                      data, linesize, width, height,
                       bitmap.buffer, bitmap.pitch,
                       bitmap.width, bitmap.rows,
                       bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
@@ -1060,17 +1102,68 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
     return 0;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+typedef struct ThreadData {
+    AVFrame *frame;
+    int box_w, box_h;
+} ThreadData;
+
+/**
+ * Draw the part of the box and the text which falls in the horizontal band
+ * of the frame assigned to the slice job.
+ */
+static int draw_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    /* keep band boundaries on chroma rows so that blending is bit-exact */
+    const int align = 1 << s->dc.vsub_max;
+    int slice_start = FFALIGN(frame->height *  jobnr      / nb_jobs, align);
+    int slice_end   = FFALIGN(frame->height * (jobnr + 1) / nb_jobs, align);
+    int slice_h, i, ret;
+    uint8_t *data[4] = { NULL };
+
+    slice_end = FFMIN(slice_end, frame->height);
+    if (slice_start >= slice_end)
+        return 0;
+    slice_h = slice_end - slice_start;
+
+    for (i = 0; i < s->dc.nb_planes; i++)
+        data[i] = frame->data[i] + (slice_start >> s->dc.vsub[i]) * frame->linesize[i];
+
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, &s->boxcolor,
+                           data, frame->linesize, frame->width, slice_h,
+                           s->x, s->y - slice_start, td->box_w, td->box_h);
+
+    if (s->shadowx || s->shadowy) {
+        if ((ret = draw_glyphs(s, data, frame->linesize, frame->width, slice_h,
+                               &s->shadowcolor, s->shadowx,
+                               s->shadowy - slice_start, 0)) < 0)
+            return ret;
+    }
+
+    if (s->borderw) {
+        if ((ret = draw_glyphs(s, data, frame->linesize, frame->width, slice_h,
+                               &s->bordercolor, 0, -slice_start, s->borderw)) < 0)
+            return ret;
+    }
+    return draw_glyphs(s, data, frame->linesize, frame->width, slice_h,
+                       &s->fontcolor, 0, -slice_start, 0);
+}
 
+/**
+ * Load the glyphs of the expanded text and compute their positions.
+ * This only depends on the text, so it is skipped as long as the text
+ * does not change from one frame to the next.
+ */
+static int layout_text(AVFilterContext *ctx)
+{
+    DrawTextContext *s = ctx->priv;
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text;
+    char *text = s->expanded_text.str;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -1078,49 +1171,18 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
+    av_freep(&s->layout_text);
+    s->nb_text_glyphs = 0;
 
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
-
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
-              av_realloc(s->positions, len*sizeof(*s->positions))))
+              av_realloc(s->positions, len*sizeof(*s->positions))) ||
+            !(s->text_glyphs =
+              av_realloc(s->text_glyphs, len*sizeof(*s->text_glyphs))))
             return AVERROR(ENOMEM);
         s->nb_positions = len;
     }
 
-    x = 0;
-    y = 0;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
@@ -1129,7 +1191,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         dummy.code = code;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
         if (!glyph) {
-            load_glyph(ctx, &glyph, code);
+            if ((ret = load_glyph(ctx, &glyph, code)) < 0)
+                return ret;
         }
 
         y_min = FFMIN(glyph->bbox.yMin, y_min);
@@ -1143,6 +1206,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     /* compute and save position for each glyph */
     glyph = NULL;
     for (i = 0, p = text; *p; i++) {
+        s->text_glyphs[i] = NULL;
         GET_UTF8(code, *p++, continue;);
 
         /* skip the \n in the sequence \r\n */
@@ -1175,7 +1239,10 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->positions[i].y = y - glyph->bitmap_top + y_max;
         if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
         else              x += glyph->advance;
+        if (code != '\t')
+            s->text_glyphs[i] = glyph;
     }
+    s->nb_text_glyphs = i;
 
     max_text_line_w = FFMAX(x, max_text_line_w);
 
@@ -1189,6 +1256,56 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
+    if (!(s->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int ret;
+    ThreadData td;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
+    }
+
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+    if (!s->layout_text || strcmp(s->layout_text, bp->str)) {
+        if ((ret = layout_text(ctx)) < 0)
+            return ret;
+    }
+
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
     s->y = s->var_values[VAR_Y] = av_expr_eval(s->y_pexpr, s->var_values, &s->prng);
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
@@ -1203,29 +1320,12 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         return 0;
 #endif
 
-    box_w = FFMIN(width - 1 , max_text_line_w);
-    box_h = FFMIN(height - 1, y + s->max_glyph_h);
-
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &s->boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x, s->y, box_w, box_h);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &s->shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
-
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &s->bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &s->fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    /* draw box and glyphs */
+    td.frame = frame;
+    td.box_w = FFMIN(width - 1 , (int)s->var_values[VAR_TEXT_W]);
+    td.box_h = FFMIN(height - 1, (int)s->var_values[VAR_TEXT_H]);
+    ctx->internal->execute(ctx, draw_slice, &td, NULL,
+                           FFMIN(height, ctx->graph->nb_threads));
 
     return 0;
 }
@@ -1235,6 +1335,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     DrawTextContext *s = ctx->priv;
+    AVFrameSideData *sd;
     int ret;
 
     if (s->reload) {
@@ -1253,6 +1354,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 
     s->var_values[VAR_PICT_TYPE] = frame->pict_type;
     s->metadata = av_frame_get_metadata(frame);
+    sd = av_frame_get_side_data(frame, AV_FRAME_DATA_AD_FRAME);
+    s->ad_pic = sd && sd->size >= AD_PIC_SIZE ? sd->data : NULL;
 
     draw_text(ctx, frame, frame->width, frame->height);
 
@@ -1295,8 +1398,10 @@ AVFilter ff_vf_drawtext = {
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
 #if FF_API_DRAWTEXT_OLD_TIMELINE
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 #else
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC |
+                     AVFILTER_FLAG_SLICE_THREADS,
 #endif
 };
@@ -150,19 +150,164 @@ static void denoise_depth(HQDN3DContext *s,
     emms_c();
 }
 
-#define denoise(...) \
+/* The spatial filter is recursive in both directions, so its rows cannot be
+ * split into independent slices. It is however separable: the horizontal
+ * pass only depends on the current row and the vertical and temporal passes
+ * only depend on the current column. The threaded path thus splits each
+ * plane into bands of BAND_H lines; the horizontal pass of a band runs on
+ * horizontal slices into s->hpass while the vertical and temporal passes of
+ * the previous band run on vertical slices. The arithmetic is the same as in
+ * denoise_spatial(), hence the output does not depend on the thread count. */
+#define BAND_H 32
+
+av_always_inline
+static void denoise_hpass(uint8_t *src, uint16_t *hpass,
+                          int w, int h, int sstride, int first_line,
+                          int16_t *spatial, int depth)
+{
+    long x, y;
+    uint32_t pixel_ant;
+
+    spatial += 256 << LUT_BITS;
+
+    for (y = 0; y < h; y++) {
+        pixel_ant = LOAD(0);
+        /* the first line is filtered once more, as in denoise_spatial() */
+        if (first_line && !y)
+            pixel_ant = lowpass(pixel_ant, LOAD(0), spatial, depth);
+        hpass[0] = pixel_ant;
+        for (x = 1; x < w; x++)
+            hpass[x] = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+        src   += sstride;
+        hpass += w;
+    }
+}
+
+av_always_inline
+static void denoise_vtpass(HQDN3DContext *s, uint16_t *hpass, uint8_t *dst,
+                           uint16_t *line_ant, uint16_t *frame_ant,
+                           int w, int h, int x0, int x1, int dstride,
+                           int first_line,
+                           int16_t *spatial, int16_t *temporal, int depth)
+{
+    long x, y;
+    uint32_t tmp;
+
+    spatial  += 256 << LUT_BITS;
+    temporal += 256 << LUT_BITS;
+
+    for (y = 0; y < h; y++) {
+        if (first_line && !y) {
+            for (x = x0; x < x1; x++) {
+                line_ant[x]  = tmp = hpass[x];
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+        } else {
+            x = x0;
+            if (s->vtpass_row[depth]) {
+                x += (x1 - x0) & ~15;
+                s->vtpass_row[depth](hpass + x0, dst + x0 * (depth > 8 ? 2 : 1),
+                                     line_ant + x0, frame_ant + x0, x - x0,
+                                     spatial, temporal);
+            }
+            for (; x < x1; x++) {
+                line_ant[x]  = tmp = lowpass(line_ant[x], hpass[x], spatial, depth);
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+        }
+        hpass     += w;
+        dst       += dstride;
+        frame_ant += w;
+    }
+}
+
+typedef struct ThreadData {
+    uint8_t *src, *dst;
+    uint16_t *frame_ant;
+    int w, h, sstride, dstride;
+    int16_t *spatial, *temporal;
+    int band;
+} ThreadData;
+
+#define DEPTH_SWITCH(func, ...) \
     switch (s->depth) {\
-        case  8: denoise_depth(__VA_ARGS__,  8); break;\
-        case  9: denoise_depth(__VA_ARGS__,  9); break;\
-        case 10: denoise_depth(__VA_ARGS__, 10); break;\
-        case 16: denoise_depth(__VA_ARGS__, 16); break;\
+        case  8: func(__VA_ARGS__,  8); break;\
+        case  9: func(__VA_ARGS__,  9); break;\
+        case 10: func(__VA_ARGS__, 10); break;\
+        case 16: func(__VA_ARGS__, 16); break;\
     }
 
+static int denoise_temporal_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int y0 = (td->h *  jobnr     ) / nb_jobs;
+    int y1 = (td->h * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_SWITCH(denoise_temporal, td->src + y0 * td->sstride,
+                 td->dst + y0 * td->dstride, td->frame_ant + y0 * td->w,
+                 td->w, y1 - y0, td->sstride, td->dstride, td->temporal);
+    return 0;
+}
+
+static int denoise_band_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int band = td->band;
+
+    /* horizontal pass of the current band */
+    if (band * BAND_H < td->h) {
+        int band_h = FFMIN(BAND_H, td->h - band * BAND_H);
+        int y0 = band * BAND_H + (band_h *  jobnr     ) / nb_jobs;
+        int y1 = band * BAND_H + (band_h * (jobnr + 1)) / nb_jobs;
+
+        DEPTH_SWITCH(denoise_hpass, td->src + y0 * td->sstride,
+                     s->hpass + ((band & 1) * BAND_H + y0 % BAND_H) * td->w,
+                     td->w, y1 - y0, td->sstride, !y0, td->spatial);
+    }
+
+    /* vertical and temporal passes of the previous band, with the slice
+     * boundaries kept cache line aligned in the output */
+    if (band--) {
+        int y0 = band * BAND_H;
+        int x0 = FFMIN(FFALIGN(td->w *  jobnr      / nb_jobs, 32), td->w);
+        int x1 = FFMIN(FFALIGN(td->w * (jobnr + 1) / nb_jobs, 32), td->w);
+
+        if (x0 < x1)
+            DEPTH_SWITCH(denoise_vtpass, s, s->hpass + (band & 1) * BAND_H * td->w,
+                         td->dst + y0 * td->dstride, s->line,
+                         td->frame_ant + y0 * td->w,
+                         td->w, FFMIN(BAND_H, td->h - y0), x0, x1, td->dstride,
+                         !y0, td->spatial, td->temporal);
+    }
+    return 0;
+}
+
+static void denoise_threaded(AVFilterContext *ctx, ThreadData *td, int nb_threads)
+{
+    int nb_bands = (td->h + BAND_H - 1) / BAND_H;
+
+    if (td->spatial[0]) {
+        nb_threads = FFMIN(nb_threads, (td->w + 31) >> 5);
+        for (td->band = 0; td->band <= nb_bands; td->band++)
+            ctx->internal->execute(ctx, denoise_band_slice, td, NULL, nb_threads);
+    } else {
+        ctx->internal->execute(ctx, denoise_temporal_slice, td, NULL,
+                               FFMIN(td->h, nb_threads));
+    }
+}
+
+#define denoise(...) DEPTH_SWITCH(denoise_depth, __VA_ARGS__)
+
 static int16_t *precalc_coefs(double dist25, int depth)
 {
     int i;
     double gamma, simil, C;
-    int16_t *ct = av_malloc((512<<LUT_BITS)*sizeof(int16_t));
+    /* one more entry for the SIMD versions, which read 32 bits per lookup */
+    int16_t *ct = av_mallocz(((512<<LUT_BITS) + 1)*sizeof(int16_t));
     if (!ct)
         return NULL;
 
@@ -212,6 +357,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
     av_freep(&s->line);
+    av_freep(&s->hpass);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
@@ -283,6 +429,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     AVFrame *out;
     int direct, c;
+    int nb_threads = ctx->graph->nb_threads;
 
     if (av_frame_is_writable(in) && !ctx->is_disabled) {
         direct = 1;
@@ -298,14 +445,33 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
+    if (nb_threads > 1 && !s->hpass) {
+        s->hpass = av_malloc_array(in->width, 2 * BAND_H * sizeof(*s->hpass));
+        if (!s->hpass)
+            nb_threads = 1;
+    }
+
     for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
-                s->line, &s->frame_prev[c],
-                FF_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
-                FF_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
-                in->linesize[c], out->linesize[c],
-                s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
-                s->coefs[c ? CHROMA_TMP     : LUMA_TMP]);
+        ThreadData td = {
+            .src       = in->data[c],
+            .dst       = out->data[c],
+            .frame_ant = s->frame_prev[c],
+            .w         = FF_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
+            .h         = FF_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
+            .sstride   = in->linesize[c],
+            .dstride   = out->linesize[c],
+            .spatial   = s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
+            .temporal  = s->coefs[c ? CHROMA_TMP     : LUMA_TMP],
+        };
+
+        /* the first frame initializes frame_prev and is always filtered
+         * by a single thread */
+        if (nb_threads > 1 && td.frame_ant)
+            denoise_threaded(ctx, &td, nb_threads);
+        else
+            denoise(s, td.src, td.dst, s->line, &s->frame_prev[c],
+                    td.w, td.h, td.sstride, td.dstride,
+                    td.spatial, td.temporal);
     }
 
     if (ctx->is_disabled) {
@@ -360,5 +526,5 @@ AVFilter ff_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -32,11 +32,14 @@ typedef struct HQDN3DContext {
     const AVClass *class;
     int16_t *coefs[4];
     uint16_t *line;
+    uint16_t *hpass;    ///< horizontally filtered plane, used by the slice threaded path
     uint16_t *frame_prev[3];
     double strength[4];
     int hsub, vsub;
     int depth;
     void (*denoise_row[17])(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
+    /** vertical and temporal passes of one row of the slice threaded path, w is a multiple of 16 */
+    void (*vtpass_row[17])(const uint16_t *hpass, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 } HQDN3DContext;
 
 #define LUMA_SPATIAL   0
@@ -0,0 +1,402 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * mosaic video filter: compose many live inputs into a grid
+ *
+ * Each input is scaled straight into its cell of the output frame. Output
+ * frames are produced at a constant rate driven by the input timestamps;
+ * an input which is late or has stopped keeps showing its last frame.
+ * Only the cells whose input changed since the previous output frame are
+ * scaled, the others are carried over from that frame.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "avfilter.h"
+#include "drawutils.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define REASONABLE_SIZE 1024
+
+/* resynchronize when an input jumps this many seconds ahead */
+#define MAX_GAP 10
+
+typedef struct MosaicTile {
+    int x, y, w, h;
+    AVFrame *frame;             ///< last frame received on the input
+    struct SwsContext *sws;
+    int64_t pts;                ///< last timestamp in the output time base
+    int changed;                ///< frame not drawn in the output yet
+} MosaicTile;
+
+typedef struct MosaicContext {
+    const AVClass *class;
+    int nb_inputs;
+    int cols, rows;
+    int w, h;
+    AVRational frame_rate;
+    int margin;
+    int padding;
+    uint8_t rgba_color[4];
+    char *flags_str;
+    int sws_flags;
+
+    MosaicTile *tiles;
+    int *jobs;                  ///< indexes of the tiles to redraw
+    int nb_jobs;
+    int64_t next_pts;
+    AVFrame *out;               ///< last output frame, reused when writable
+    FFDrawContext draw;
+    FFDrawColor blank;
+} MosaicContext;
+
+#define OFFSET(x) offsetof(MosaicContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption mosaic_options[] = {
+    { "inputs",  "set number of inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64 = 4}, 1, REASONABLE_SIZE, FLAGS },
+    { "n",       "set number of inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64 = 4}, 1, REASONABLE_SIZE, FLAGS },
+    { "layout",  "set grid size, guessed from the number of inputs if not set", OFFSET(cols), AV_OPT_TYPE_IMAGE_SIZE, {.str = NULL}, 0, 0, FLAGS },
+    { "size",    "set output frame size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "1280x720"}, 0, 0, FLAGS },
+    { "s",       "set output frame size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "1280x720"}, 0, 0, FLAGS },
+    { "rate",    "set output frame rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, 0, FLAGS },
+    { "r",       "set output frame rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, 0, FLAGS },
+    { "margin",  "set outer border margin in pixels",    OFFSET(margin),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1024, FLAGS },
+    { "padding", "set inner border thickness in pixels", OFFSET(padding),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1024, FLAGS },
+    { "color",   "set the color of the unused area", OFFSET(rgba_color), AV_OPT_TYPE_COLOR, {.str = "black"}, .flags = FLAGS },
+    { "flags",   "set libswscale scaling flags", OFFSET(flags_str), AV_OPT_TYPE_STRING, {.str = "fast_bilinear"}, .flags = FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(mosaic);
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MosaicContext *s = ctx->priv;
+    int i;
+
+    if (!s->cols) {
+        for (s->cols = 1; s->cols * s->cols < s->nb_inputs; s->cols++)
+            ;
+        s->rows = (s->nb_inputs + s->cols - 1) / s->cols;
+    }
+    if (s->cols > REASONABLE_SIZE || s->rows > REASONABLE_SIZE) {
+        av_log(ctx, AV_LOG_ERROR, "Layout %dx%d is insane.\n",
+               s->cols, s->rows);
+        return AVERROR(EINVAL);
+    }
+    if (s->nb_inputs > s->cols * s->rows) {
+        av_log(ctx, AV_LOG_ERROR, "%d inputs do not fit in a %dx%d layout.\n",
+               s->nb_inputs, s->cols, s->rows);
+        return AVERROR(EINVAL);
+    }
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        int ret = av_opt_eval_flags(&class, o, s->flags_str, &s->sws_flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    s->tiles = av_calloc(s->nb_inputs, sizeof(*s->tiles));
+    s->jobs  = av_calloc(s->nb_inputs, sizeof(*s->jobs));
+    if (!s->tiles || !s->jobs)
+        return AVERROR(ENOMEM);
+    s->next_pts = AV_NOPTS_VALUE;
+
+    for (i = 0; i < s->nb_inputs; i++) {
+        AVFilterPad inpad = { 0 };
+
+        s->tiles[i].pts = INT64_MIN;
+        inpad.name = av_asprintf("input%d", i);
+        if (!inpad.name)
+            return AVERROR(ENOMEM);
+        inpad.type         = AVMEDIA_TYPE_VIDEO;
+        inpad.filter_frame = filter_frame;
+        ff_insert_inpad(ctx, i, &inpad);
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MosaicContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < ctx->nb_inputs; i++)
+        av_freep(&ctx->input_pads[i].name);
+    if (s->tiles) {
+        for (i = 0; i < s->nb_inputs; i++) {
+            av_frame_free(&s->tiles[i].frame);
+            sws_freeContext(s->tiles[i].sws);
+        }
+    }
+    av_freep(&s->tiles);
+    av_freep(&s->jobs);
+    av_frame_free(&s->out);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat out_fmts[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE
+    };
+    int i;
+
+    for (i = 0; i < ctx->nb_inputs; i++) {
+        const AVPixFmtDescriptor *desc = NULL;
+        AVFilterFormats *formats = NULL;
+
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+            int ret;
+            if ((sws_isSupportedInput(pix_fmt) ||
+                 sws_isSupportedEndiannessConversion(pix_fmt))
+                && (ret = ff_add_format(&formats, pix_fmt)) < 0) {
+                ff_formats_unref(&formats);
+                return ret;
+            }
+        }
+        ff_formats_ref(formats, &ctx->inputs[i]->out_formats);
+    }
+    ff_formats_ref(ff_make_format_list(out_fmts), &ctx->outputs[0]->in_formats);
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MosaicContext *s     = ctx->priv;
+    const int total_margin_w = (s->cols - 1) * s->padding + 2 * s->margin;
+    const int total_margin_h = (s->rows - 1) * s->padding + 2 * s->margin;
+    int cell_w, cell_h, x0, y0, i;
+
+    /* libswscale writes whole SIMD blocks of up to 16 chroma samples, keep
+     * the cells a multiple of 32 pixels wide so that the scaling of a cell
+     * never spills into its right neighbour; the rows stay even for 4:2:0 */
+    cell_w = (s->w - total_margin_w) / s->cols & ~31;
+    cell_h = (s->h - total_margin_h) / s->rows & ~1;
+    if (cell_w <= 0 || cell_h <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "Size %dx%d is too small for a %dx%d layout.\n",
+               s->w, s->h, s->cols, s->rows);
+        return AVERROR(EINVAL);
+    }
+    /* center the grid in what is left over */
+    x0 = s->margin + (s->w - total_margin_w - cell_w * s->cols) / 2;
+    y0 = s->margin + (s->h - total_margin_h - cell_h * s->rows) / 2;
+
+    for (i = 0; i < s->nb_inputs; i++) {
+        MosaicTile *tile = &s->tiles[i];
+
+        tile->x = x0 + (cell_w + s->padding) * (i % s->cols) & ~1;
+        tile->y = y0 + (cell_h + s->padding) * (i / s->cols) & ~1;
+        tile->w = cell_w;
+        tile->h = cell_h;
+    }
+
+    outlink->w                   = s->w;
+    outlink->h                   = s->h;
+    outlink->sample_aspect_ratio = (AVRational){ 1, 1 };
+    outlink->frame_rate          = s->frame_rate;
+    outlink->time_base           = av_inv_q(s->frame_rate);
+    ff_draw_init(&s->draw, outlink->format, 0);
+    ff_draw_color(&s->draw, &s->blank, s->rgba_color);
+
+    outlink->flags |= FF_LINK_FLAG_REQUEST_LOOP;
+
+    return 0;
+}
+
+static int scale_tiles(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MosaicContext *s = ctx->priv;
+    AVFrame *out     = arg;
+    const int start  = (s->nb_jobs *  jobnr   ) / nb_jobs;
+    const int end    = (s->nb_jobs * (jobnr+1)) / nb_jobs;
+    int i, p;
+
+    for (i = start; i < end; i++) {
+        MosaicTile *tile = &s->tiles[s->jobs[i]];
+        uint8_t *dst[4] = { NULL };
+
+        for (p = 0; p < 3; p++) {
+            dst[p] = out->data[p] + (tile->y >> s->draw.vsub[p]) * out->linesize[p] +
+                                    (tile->x >> s->draw.hsub[p]);
+        }
+        sws_scale(tile->sws, (const uint8_t * const *)tile->frame->data,
+                  tile->frame->linesize, 0, tile->frame->height,
+                  dst, out->linesize);
+    }
+    return 0;
+}
+
+static int push_frame(AVFilterContext *ctx)
+{
+    MosaicContext *s        = ctx->priv;
+    AVFilterLink *outlink   = ctx->outputs[0];
+    AVFrame *out;
+    int i;
+
+    if (!s->out || !av_frame_is_writable(s->out)) {
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out)
+            return AVERROR(ENOMEM);
+        if (s->out) {
+            av_image_copy(out->data, out->linesize,
+                          (const uint8_t **)s->out->data, s->out->linesize,
+                          outlink->format, outlink->w, outlink->h);
+        } else {
+            ff_fill_rectangle(&s->draw, &s->blank, out->data, out->linesize,
+                              0, 0, outlink->w, outlink->h);
+        }
+        av_frame_free(&s->out);
+        s->out = out;
+    }
+    out = s->out;
+    out->pts                 = s->next_pts++;
+    out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+
+    s->nb_jobs = 0;
+    for (i = 0; i < s->nb_inputs; i++) {
+        MosaicTile *tile = &s->tiles[i];
+        AVFrame *frame   = tile->frame;
+
+        if (!tile->changed)
+            continue;
+        tile->changed = 0;
+        tile->sws = sws_getCachedContext(tile->sws,
+                                         frame->width, frame->height, frame->format,
+                                         tile->w, tile->h, outlink->format,
+                                         s->sws_flags, NULL, NULL, NULL);
+        if (!tile->sws) {
+            av_log(ctx, AV_LOG_ERROR, "Cannot scale %dx%d %s to %dx%d on %s.\n",
+                   frame->width, frame->height,
+                   (char *)av_x_if_null(av_get_pix_fmt_name(frame->format), "none"),
+                   tile->w, tile->h, ctx->input_pads[i].name);
+            return AVERROR(EINVAL);
+        }
+        s->jobs[s->nb_jobs++] = i;
+    }
+    if (s->nb_jobs)
+        ctx->internal->execute(ctx, scale_tiles, out, NULL,
+                               FFMIN(s->nb_jobs, ctx->graph->nb_threads));
+
+    out = av_frame_clone(s->out);
+    if (!out)
+        return AVERROR(ENOMEM);
+    return ff_filter_frame(outlink, out);
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx  = inlink->dst;
+    MosaicContext *s      = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    MosaicTile *tile      = &s->tiles[FF_INLINK_IDX(inlink)];
+    int ret;
+
+    if (frame->pts != AV_NOPTS_VALUE) {
+        /* a frame for the next interval: the current one is complete */
+        int64_t pts = av_rescale_q(frame->pts, inlink->time_base,
+                                   outlink->time_base);
+
+        if (s->next_pts == AV_NOPTS_VALUE)
+            s->next_pts = pts;
+        if (pts - s->next_pts > MAX_GAP * av_q2d(s->frame_rate)) {
+            av_log(ctx, AV_LOG_WARNING, "Timestamp jump on %s, resynchronizing.\n",
+                   ctx->input_pads[FF_INLINK_IDX(inlink)].name);
+            s->next_pts = pts;
+        }
+        while (s->next_pts < pts) {
+            if ((ret = push_frame(ctx)) < 0) {
+                av_frame_free(&frame);
+                return ret;
+            }
+        }
+        tile->pts = pts;
+    }
+
+    av_frame_free(&tile->frame);
+    tile->frame   = frame;
+    tile->changed = 1;
+    return 0;
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MosaicContext *s     = ctx->priv;
+    int i, ret;
+
+    for (;;) {
+        int in_no = -1;
+
+        /* pull from the input which is the most behind */
+        for (i = 0; i < s->nb_inputs; i++)
+            if (!ctx->inputs[i]->closed &&
+                (in_no < 0 || s->tiles[i].pts < s->tiles[in_no].pts))
+                in_no = i;
+        if (in_no < 0)
+            break;
+        ret = ff_request_frame(ctx->inputs[in_no]);
+        if (ret != AVERROR_EOF)
+            return ret;
+    }
+
+    /* flush the frames received since the last output frame */
+    for (i = 0; i < s->nb_inputs; i++)
+        if (s->tiles[i].changed && s->next_pts != AV_NOPTS_VALUE)
+            return push_frame(ctx);
+    return AVERROR_EOF;
+}
+
+static const AVFilterPad mosaic_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_mosaic = {
+    .name          = "mosaic",
+    .description   = NULL_IF_CONFIG_SMALL("Compose many live video inputs into a grid."),
+    .priv_size     = sizeof(MosaicContext),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .outputs       = mosaic_outputs,
+    .priv_class    = &mosaic_class,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -27,32 +27,12 @@
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/timestamp.h"
-#include "libavcodec/dsputil.h"
-#include "libavcodec/pixblockdsp.h"
+#include "config.h"
 #include "avfilter.h"
 #include "internal.h"
 #include "formats.h"
 #include "video.h"
-
-typedef struct {
-    const AVClass *class;
-    int lo, hi;                    ///< lower and higher threshold number of differences
-                                   ///< values for 8x8 blocks
-
-    float frac;                    ///< threshold of changed pixels over the total fraction
-
-    int max_drop_count;            ///< if positive: maximum number of sequential frames to drop
-                                   ///< if negative: minimum number of frames between two drops
-
-    int drop_count;                ///< if positive: number of frames sequentially dropped
-                                   ///< if negative: number of sequential frames which were not dropped
-
-    int hsub, vsub;                ///< chroma subsampling values
-    AVFrame *ref;                  ///< reference picture
-    DSPContext dspctx;             ///< context providing optimized diff routines
-    PixblockDSPContext pdsp;
-    AVCodecContext *avctx;         ///< codec context required for the DSPContext
-} DecimateContext;
+#include "vf_mpdecimate.h"
 
 #define OFFSET(x) offsetof(DecimateContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
@@ -63,11 +43,46 @@ static const AVOption mpdecimate_options[] = {
     { "hi",   "set high dropping threshold", OFFSET(hi), AV_OPT_TYPE_INT, {.i64=64*12}, INT_MIN, INT_MAX, FLAGS },
     { "lo",   "set low dropping threshold", OFFSET(lo), AV_OPT_TYPE_INT, {.i64=64*5}, INT_MIN, INT_MAX, FLAGS },
     { "frac", "set fraction dropping threshold",  OFFSET(frac), AV_OPT_TYPE_FLOAT, {.dbl=0.33}, 0, 1, FLAGS },
+    { "zones", "set grid of zones for which activity is exported as metadata", OFFSET(zones_w), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, FLAGS },
+    { "downscale", "only analyse the luma plane, downscaled by the given factor", OFFSET(downscale), AV_OPT_TYPE_INT, {.i64=1}, 1, 8, FLAGS },
     { NULL }
 };
 
 AVFILTER_DEFINE_CLASS(mpdecimate);
 
+static void sad_row_c(const uint8_t *cur, const uint8_t *ref, ptrdiff_t linesize,
+                      int *sad, int nb_blocks)
+{
+    int i, x, y;
+
+    for (i = 0; i < nb_blocks; i++) {
+        int d = 0;
+        for (y = 0; y < 8; y++)
+            for (x = 0; x < 8; x++)
+                d += FFABS(cur[y*linesize + 4*i + x] - ref[y*linesize + 4*i + x]);
+        sad[i] = d;
+    }
+}
+
+/**
+ * Compute in decimate->sad the SADs of the 8x8 blocks of the row of blocks
+ * starting at line y, and return their number.
+ */
+static int sad_row(DecimateContext *decimate, const uint8_t *cur,
+                   const uint8_t *ref, int linesize, int w, int y)
+{
+    /* blocks start at x = 8, 12, ... while x < w-7 */
+    const int nb_blocks = w >= 16 ? (w - 16) / 4 + 1 : 0;
+    const int nb_simd   = nb_blocks & ~3;
+
+    cur += 8 + y*linesize;
+    ref += 8 + y*linesize;
+    decimate->sad_row(cur, ref, linesize, decimate->sad, nb_simd);
+    sad_row_c(cur + 4*nb_simd, ref + 4*nb_simd, linesize,
+              decimate->sad + nb_simd, nb_blocks - nb_simd);
+    return nb_blocks;
+}
+
 /**
  * Return 1 if the two planes are different, 0 otherwise.
  */
@@ -76,21 +91,16 @@ static int diff_planes(AVFilterContext *ctx,
                        int w, int h)
 {
     DecimateContext *decimate = ctx->priv;
-    DSPContext *dspctx = &decimate->dspctx;
-    PixblockDSPContext *pdsp = &decimate->pdsp;
 
-    int x, y;
+    int i, y, nb_blocks;
     int d, c = 0;
     int t = (w/16)*(h/16)*decimate->frac;
-    int16_t block[8*8];
 
     /* compute difference for blocks of 8x8 bytes */
     for (y = 0; y < h-7; y += 4) {
-        for (x = 8; x < w-7; x += 4) {
-            pdsp->diff_pixels(block,
-                                cur+x+y*linesize,
-                                ref+x+y*linesize, linesize);
-            d = dspctx->sum_abs_dctelem(block);
+        nb_blocks = sad_row(decimate, cur, ref, linesize, w, y);
+        for (i = 0; i < nb_blocks; i++) {
+            d = decimate->sad[i];
             if (d > decimate->hi)
                 return 1;
             if (d > decimate->lo) {
@@ -120,6 +130,11 @@ static int decimate_frame(AVFilterContext *ctx,
         (decimate->drop_count-1) > decimate->max_drop_count)
         return 0;
 
+    if (decimate->downscale > 1)
+        return !diff_planes(ctx, decimate->small[1], decimate->small[0],
+                            decimate->small_linesize,
+                            decimate->small_w, decimate->small_h);
+
     for (plane = 0; ref->data[plane] && ref->linesize[plane]; plane++) {
         int vsub = plane == 1 || plane == 2 ? decimate->vsub : 0;
         int hsub = plane == 1 || plane == 2 ? decimate->hsub : 0;
@@ -133,6 +148,89 @@ static int decimate_frame(AVFilterContext *ctx,
     return 1;
 }
 
+/**
+ * Compute the fraction of the blocks of each zone of the luma plane cur which
+ * differ by more than the lo threshold from ref, and export it in the
+ * metadata of frame.
+ */
+static void set_zone_activity(AVFilterContext *ctx, AVFrame *frame,
+                              uint8_t *cur, uint8_t *ref, int linesize,
+                              int w, int h)
+{
+    DecimateContext *decimate = ctx->priv;
+    const int nb_zones = decimate->zones_w * decimate->zones_h;
+    int x, y, i, nb_blocks, changed = 0, blocks = 0;
+    char key[64], value[32];
+
+    memset(decimate->zone_blocks,  0, nb_zones * sizeof(*decimate->zone_blocks));
+    memset(decimate->zone_changed, 0, nb_zones * sizeof(*decimate->zone_changed));
+
+    for (y = 0; y < h-7; y += 4) {
+        const int zone_row = y * decimate->zones_h / h * decimate->zones_w;
+
+        nb_blocks = sad_row(decimate, cur, ref, linesize, w, y);
+        for (i = 0, x = 8; i < nb_blocks; i++, x += 4) {
+            const int zone = zone_row + x * decimate->zones_w / w;
+
+            decimate->zone_blocks[zone]++;
+            if (decimate->sad[i] > decimate->lo)
+                decimate->zone_changed[zone]++;
+        }
+    }
+
+    for (i = 0; i < nb_zones; i++) {
+        snprintf(key, sizeof(key), "lavfi.mpdecimate.zone.%d", i);
+        snprintf(value, sizeof(value), "%f", decimate->zone_blocks[i] ?
+                 decimate->zone_changed[i] / (double)decimate->zone_blocks[i] : 0);
+        av_dict_set(avpriv_frame_get_metadatap(frame), key, value, 0);
+        changed += decimate->zone_changed[i];
+        blocks  += decimate->zone_blocks[i];
+    }
+    snprintf(value, sizeof(value), "%f", blocks ? changed / (double)blocks : 0);
+    av_dict_set(avpriv_frame_get_metadatap(frame), "lavfi.mpdecimate.activity", value, 0);
+}
+
+static void downscale_row2_c(uint8_t *dst, const uint8_t *src,
+                             ptrdiff_t linesize, int w)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        dst[x] = (src[2*x] + src[2*x + 1] +
+                  src[2*x + linesize] + src[2*x + linesize + 1] + 2) >> 2;
+}
+
+/**
+ * Average the luma plane of frame over blocks of downscale x downscale
+ * pixels into decimate->small[1].
+ */
+static void downscale_luma(DecimateContext *decimate, const AVFrame *frame)
+{
+    const int f = decimate->downscale;
+    const int linesize = frame->linesize[0];
+    int x, y, i, j;
+
+    for (y = 0; y < decimate->small_h; y++) {
+        const uint8_t *src = frame->data[0] + y * f * linesize;
+        uint8_t *dst = decimate->small[1] + y * decimate->small_linesize;
+
+        if (f == 2) {
+            const int w8 = decimate->small_w & ~7;
+
+            decimate->downscale_row2(dst, src, linesize, w8);
+            downscale_row2_c(dst + w8, src + 2*w8, linesize, decimate->small_w - w8);
+            continue;
+        }
+        for (x = 0; x < decimate->small_w; x++) {
+            int sum = f * f / 2;
+            for (j = 0; j < f; j++)
+                for (i = 0; i < f; i++)
+                    sum += src[j*linesize + f*x + i];
+            dst[x] = sum / (f * f);
+        }
+    }
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     DecimateContext *decimate = ctx->priv;
@@ -140,11 +238,24 @@ static av_cold int init(AVFilterContext *ctx)
     av_log(ctx, AV_LOG_VERBOSE, "max_drop_count:%d hi:%d lo:%d frac:%f\n",
            decimate->max_drop_count, decimate->hi, decimate->lo, decimate->frac);
 
-    decimate->avctx = avcodec_alloc_context3(NULL);
-    if (!decimate->avctx)
-        return AVERROR(ENOMEM);
-    avpriv_dsputil_init(&decimate->dspctx, decimate->avctx);
-    ff_pixblockdsp_init(&decimate->pdsp, decimate->avctx);
+    decimate->sad_row        = sad_row_c;
+    decimate->downscale_row2 = downscale_row2_c;
+    if (ARCH_X86)
+        ff_mpdecimate_init_x86(decimate);
+
+    if (decimate->zones_w && decimate->zones_h) {
+        if (decimate->zones_w > 64 || decimate->zones_h > 64) {
+            av_log(ctx, AV_LOG_ERROR, "Zone grid %dx%d is too large.\n",
+                   decimate->zones_w, decimate->zones_h);
+            return AVERROR(EINVAL);
+        }
+        decimate->zone_blocks  = av_malloc_array(decimate->zones_w * decimate->zones_h,
+                                                 sizeof(*decimate->zone_blocks));
+        decimate->zone_changed = av_malloc_array(decimate->zones_w * decimate->zones_h,
+                                                 sizeof(*decimate->zone_changed));
+        if (!decimate->zone_blocks || !decimate->zone_changed)
+            return AVERROR(ENOMEM);
+    }
 
     return 0;
 }
@@ -153,10 +264,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     DecimateContext *decimate = ctx->priv;
     av_frame_free(&decimate->ref);
-    if (decimate->avctx) {
-        avcodec_close(decimate->avctx);
-        av_freep(&decimate->avctx);
-    }
+    av_freep(&decimate->zone_blocks);
+    av_freep(&decimate->zone_changed);
+    av_freep(&decimate->small[0]);
+    av_freep(&decimate->small[1]);
+    av_freep(&decimate->sad);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -184,6 +296,23 @@ static int config_input(AVFilterLink *inlink)
     decimate->hsub = pix_desc->log2_chroma_w;
     decimate->vsub = pix_desc->log2_chroma_h;
 
+    av_freep(&decimate->sad);
+    decimate->sad = av_malloc_array(inlink->w / 4 + 1, sizeof(*decimate->sad));
+    if (!decimate->sad)
+        return AVERROR(ENOMEM);
+
+    if (decimate->downscale > 1) {
+        decimate->small_w        = inlink->w / decimate->downscale;
+        decimate->small_h        = inlink->h / decimate->downscale;
+        decimate->small_linesize = FFALIGN(decimate->small_w, 32);
+        av_freep(&decimate->small[0]);
+        av_freep(&decimate->small[1]);
+        decimate->small[0] = av_malloc(decimate->small_linesize * decimate->small_h);
+        decimate->small[1] = av_malloc(decimate->small_linesize * decimate->small_h);
+        if (!decimate->small[0] || !decimate->small[1])
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -193,11 +322,25 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *cur)
     AVFilterLink *outlink = inlink->dst->outputs[0];
     int ret;
 
+    if (decimate->downscale > 1)
+        downscale_luma(decimate, cur);
+
     if (decimate->ref && decimate_frame(inlink->dst, cur, decimate->ref)) {
         decimate->drop_count = FFMAX(1, decimate->drop_count+1);
     } else {
+        if (decimate->ref && decimate->zone_blocks) {
+            if (decimate->downscale > 1)
+                set_zone_activity(inlink->dst, cur, decimate->small[1],
+                                  decimate->small[0], decimate->small_linesize,
+                                  decimate->small_w, decimate->small_h);
+            else
+                set_zone_activity(inlink->dst, cur, cur->data[0],
+                                  decimate->ref->data[0], decimate->ref->linesize[0],
+                                  decimate->ref->width, decimate->ref->height);
+        }
         av_frame_free(&decimate->ref);
         decimate->ref = cur;
+        FFSWAP(uint8_t *, decimate->small[0], decimate->small[1]);
         decimate->drop_count = FFMIN(-1, decimate->drop_count-1);
 
         if (ret = ff_filter_frame(outlink, av_frame_clone(cur)) < 0)
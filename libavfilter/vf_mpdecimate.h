@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2003 Rich Felker
+ * Copyright (c) 2012 Stefano Sabatini
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_VF_MPDECIMATE_H
+#define AVFILTER_VF_MPDECIMATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/opt.h"
+
+typedef struct {
+    const AVClass *class;
+    int lo, hi;                    ///< lower and higher threshold number of differences
+                                   ///< values for 8x8 blocks
+
+    float frac;                    ///< threshold of changed pixels over the total fraction
+
+    int max_drop_count;            ///< if positive: maximum number of sequential frames to drop
+                                   ///< if negative: minimum number of frames between two drops
+
+    int drop_count;                ///< if positive: number of frames sequentially dropped
+                                   ///< if negative: number of sequential frames which were not dropped
+
+    int hsub, vsub;                ///< chroma subsampling values
+    AVFrame *ref;                  ///< reference picture
+
+    int downscale;                 ///< factor the luma plane is downscaled by before analysis
+    uint8_t *small[2];             ///< downscaled luma of the reference and current pictures
+    int small_w, small_h, small_linesize;
+
+    int *sad;                      ///< SADs of one row of blocks
+    /**
+     * Compute the SADs of nb_blocks 8x8 blocks, each one starting 4 pixels
+     * to the right of the previous one. nb_blocks is a multiple of 4.
+     */
+    void (*sad_row)(const uint8_t *cur, const uint8_t *ref, ptrdiff_t linesize,
+                    int *sad, int nb_blocks);
+    /**
+     * Average w blocks of 2x2 pixels of src into dst, w is a multiple of 8.
+     */
+    void (*downscale_row2)(uint8_t *dst, const uint8_t *src, ptrdiff_t linesize, int w);
+
+    int zones_w, zones_h;          ///< grid of zones whose activity is exported as metadata
+    int *zone_blocks;              ///< number of luma blocks in each zone
+    int *zone_changed;             ///< number of luma blocks differing by more than lo in each zone
+} DecimateContext;
+
+void ff_mpdecimate_init_x86(DecimateContext *decimate);
+
+#endif /* AVFILTER_VF_MPDECIMATE_H */
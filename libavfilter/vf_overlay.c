@@ -358,14 +358,35 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+typedef struct ThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+} ThreadData;
+
+/**
+ * Compute the part [*start, *end) of the row range [start, end) that
+ * belongs to the given slice job.
+ */
+static inline void slice_rows(int *start, int *end, int jobnr, int nb_jobs)
+{
+    const int rows = *end - *start;
+
+    *end   = *start + rows * (jobnr + 1) / nb_jobs;
+    *start = *start + rows *  jobnr      / nb_jobs;
+}
+
 /**
- * Blend image in src to destination buffer dst at position (x, y).
+ * Blend the slice jobnr of image in td->src to destination buffer td->dst
+ * at position (s->x, s->y).
  */
-static void blend_image(AVFilterContext *ctx,
-                        AVFrame *dst, const AVFrame *src,
-                        int x, int y)
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *dst = td->dst;
+    const AVFrame *src = td->src;
+    const int x = s->x;
+    const int y = s->y;
     int i, imax, j, jmax, k, kmax;
     const int src_w = src->width;
     const int src_h = src->height;
@@ -374,7 +395,7 @@ static void blend_image(AVFilterContext *ctx,
 
     if (x >= dst_w || x+src_w < 0 ||
         y >= dst_h || y+src_h < 0)
-        return; /* no intersection */
+        return 0; /* no intersection */
 
     if (s->main_is_packed_rgb) {
         uint8_t alpha;          ///< the amount of overlay to blend on to main
@@ -391,11 +412,13 @@ static void blend_image(AVFilterContext *ctx,
         const int main_has_alpha = s->main_has_alpha;
         uint8_t *s, *sp, *d, *dp;
 
-        i = FFMAX(-y, 0);
+        i    = FFMAX(-y, 0);
+        imax = FFMIN(-y + dst_h, src_h);
+        slice_rows(&i, &imax, jobnr, nb_jobs);
         sp = src->data[0] + i     * src->linesize[0];
         dp = dst->data[0] + (y+i) * dst->linesize[0];
 
-        for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+        for (; i < imax; i++) {
             j = FFMAX(-x, 0);
             s = sp + j     * sstep;
             d = dp + (x+j) * dstep;
@@ -449,11 +472,13 @@ static void blend_image(AVFilterContext *ctx,
             uint8_t alpha;          ///< the amount of overlay to blend on to main
             uint8_t *s, *sa, *d, *da;
 
-            i = FFMAX(-y, 0);
+            i    = FFMAX(-y, 0);
+            imax = FFMIN(-y + dst_h, src_h);
+            slice_rows(&i, &imax, jobnr, nb_jobs);
             sa = src->data[3] + i     * src->linesize[3];
             da = dst->data[3] + (y+i) * dst->linesize[3];
 
-            for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+            for (; i < imax; i++) {
                 j = FFMAX(-x, 0);
                 s = sa + j;
                 d = da + x+j;
@@ -492,12 +517,14 @@ static void blend_image(AVFilterContext *ctx,
             int xp = x>>hsub;
             uint8_t *s, *sp, *d, *dp, *a, *ap;
 
-            j = FFMAX(-yp, 0);
+            j    = FFMAX(-yp, 0);
+            jmax = FFMIN(-yp + dst_hp, src_hp);
+            slice_rows(&j, &jmax, jobnr, nb_jobs);
             sp = src->data[i] + j         * src->linesize[i];
             dp = dst->data[i] + (yp+j)    * dst->linesize[i];
             ap = src->data[3] + (j<<vsub) * src->linesize[3];
 
-            for (jmax = FFMIN(-yp + dst_hp, src_hp); j < jmax; j++) {
+            for (; j < jmax; j++) {
                 k = FFMAX(-xp, 0);
                 d = dp + xp+k;
                 s = sp + k;
@@ -547,6 +574,7 @@ static void blend_image(AVFilterContext *ctx,
             }
         }
     }
+    return 0;
 }
 
 static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
@@ -554,6 +582,8 @@ static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
 {
     OverlayContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData td;
+    int nb_jobs;
 
     if (s->eval_mode == EVAL_MODE_FRAME) {
         int64_t pos = av_frame_get_pkt_pos(mainpic);
@@ -570,7 +600,12 @@ static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
                s->var_values[VAR_Y], s->y);
     }
 
-    blend_image(ctx, mainpic, second, s->x, s->y);
+    td.dst = mainpic;
+    td.src = second;
+    /* blending onto a main picture with alpha reads destination pixels from
+     * the neighbouring rows, which may belong to another slice */
+    nb_jobs = s->main_has_alpha ? 1 : FFMIN(second->height, ctx->graph->nb_threads);
+    ctx->internal->execute(ctx, blend_slice, &td, NULL, nb_jobs);
     return mainpic;
 }
 
@@ -675,5 +710,6 @@ AVFilter ff_vf_overlay = {
     .process_command = process_command,
     .inputs        = avfilter_vf_overlay_inputs,
     .outputs       = avfilter_vf_overlay_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -159,6 +159,34 @@ static int end_last_frame(AVFilterContext *ctx)
     return ret;
 }
 
+typedef struct ThreadData {
+    AVFrame *in;
+    unsigned x0, y0;
+} ThreadData;
+
+static int copy_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TileContext *tile    = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData *td       = arg;
+    /* keep slice boundaries on chroma rows so that no line is shared */
+    const int align = 1 << tile->draw.vsub_max;
+    const int h     = inlink->h;
+    int slice_start = FFALIGN(h *  jobnr      / nb_jobs, align);
+    int slice_end   = FFALIGN(h * (jobnr + 1) / nb_jobs, align);
+
+    slice_end = FFMIN(slice_end, h);
+    if (slice_start >= slice_end)
+        return 0;
+
+    ff_copy_rectangle2(&tile->draw,
+                       tile->out_ref->data, tile->out_ref->linesize,
+                       td->in->data, td->in->linesize,
+                       td->x0, td->y0 + slice_start, 0, slice_start,
+                       inlink->w, slice_end - slice_start);
+    return 0;
+}
+
 /* Note: direct rendering is not possible since there is no guarantee that
  * buffers are fed to filter_frame in the order they were obtained from
  * get_buffer (think B-frames). */
@@ -168,7 +196,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AVFilterContext *ctx  = inlink->dst;
     TileContext *tile     = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
-    unsigned x0, y0;
+    ThreadData td;
 
     if (!tile->current) {
         tile->out_ref = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -188,11 +216,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
                               0, 0, outlink->w, outlink->h);
     }
 
-    get_current_tile_pos(ctx, &x0, &y0);
-    ff_copy_rectangle2(&tile->draw,
-                       tile->out_ref->data, tile->out_ref->linesize,
-                       picref->data, picref->linesize,
-                       x0, y0, 0, 0, inlink->w, inlink->h);
+    td.in = picref;
+    get_current_tile_pos(ctx, &td.x0, &td.y0);
+    ctx->internal->execute(ctx, copy_slice, &td, NULL,
+                           FFMIN(inlink->h, ctx->graph->nb_threads));
 
     av_frame_free(&picref);
     if (++tile->current == tile->nb_frames)
@@ -242,4 +269,5 @@ AVFilter ff_vf_tile = {
     .inputs        = tile_inputs,
     .outputs       = tile_outputs,
     .priv_class    = &tile_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,118 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/drawutils.h"
+
+#if HAVE_SSE4_INLINE
+/* The blend is done as (dst * 0x1010101 + a * (src - dst)) >> 24, which is
+ * the same modulo 2^32 as the C version, so the output is bit-exact. */
+#define BLEND4                                                              \
+    "pmulld         %%xmm6, %%xmm0      \n\t" /* a = mask * alpha */        \
+    "movdqa         %%xmm5, %%xmm2      \n\t"                               \
+    "psubd          %%xmm1, %%xmm2      \n\t" /* src - dst */               \
+    "pmulld         %%xmm4, %%xmm1      \n\t" /* dst * 0x1010101 */         \
+    "pmulld         %%xmm2, %%xmm0      \n\t"                               \
+    "paddd          %%xmm0, %%xmm1      \n\t"                               \
+    "psrld             $24, %%xmm1      \n\t"                               \
+    "packssdw       %%xmm1, %%xmm1      \n\t"                               \
+    "packuswb       %%xmm1, %%xmm1      \n\t"
+
+#define BLEND_INIT                                                          \
+    "movd           %[src], %%xmm5      \n\t"                               \
+    "movd         %[alpha], %%xmm6      \n\t"                               \
+    "movd             %[k], %%xmm4      \n\t"                               \
+    "pshufd       $0, %%xmm5, %%xmm5    \n\t"                               \
+    "pshufd       $0, %%xmm6, %%xmm6    \n\t"                               \
+    "pshufd       $0, %%xmm4, %%xmm4    \n\t"
+
+static void blend_row8_sse4(uint8_t *dst, const uint8_t *mask, int w,
+                            unsigned src, unsigned alpha)
+{
+    x86_reg x = -w;
+    unsigned k = 0x1010101;
+
+    if (!w)
+        return;
+    __asm__ volatile(
+        BLEND_INIT
+        "1:                                 \n\t"
+        "pmovzxbd    (%1, %0), %%xmm0       \n\t"
+        "pmovzxbd    (%2, %0), %%xmm1       \n\t"
+        BLEND4
+        "movd           %%xmm1, (%2, %0)    \n\t"
+        "add                $4, %0          \n\t"
+        " jl                1b              \n\t"
+        : "+r"(x)
+        : "r"(mask + w), "r"(dst + w),
+          [src]"m"(src), [alpha]"m"(alpha), [k]"m"(k)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",
+                       "%xmm4", "%xmm5", "%xmm6",)
+          "memory"
+    );
+}
+
+static void blend_row8_2x2_sse4(uint8_t *dst, const uint8_t *mask,
+                                ptrdiff_t mask_linesize, int w,
+                                unsigned src, unsigned alpha, int shift)
+{
+    x86_reg x = -w;
+    unsigned k = 0x1010101;
+
+    if (!w)
+        return;
+    __asm__ volatile(
+        BLEND_INIT
+        "movd         %[shift], %%xmm7      \n\t"
+        "pcmpeqw        %%xmm3, %%xmm3      \n\t"
+        "psrlw             $15, %%xmm3      \n\t" // 1
+        "1:                                 \n\t"
+        "pmovzxbw    (%1, %0, 2), %%xmm0    \n\t"
+        "pmovzxbw    (%3, %0, 2), %%xmm2    \n\t"
+        "pmovzxbd    (%2, %0), %%xmm1       \n\t"
+        "paddw          %%xmm2, %%xmm0      \n\t"
+        "pmaddwd        %%xmm3, %%xmm0      \n\t" // sum of 2x2 samples
+        "psrld          %%xmm7, %%xmm0      \n\t"
+        BLEND4
+        "movd           %%xmm1, (%2, %0)    \n\t"
+        "add                $4, %0          \n\t"
+        " jl                1b              \n\t"
+        : "+r"(x)
+        : "r"(mask + 2 * w), "r"(dst + w), "r"(mask + mask_linesize + 2 * w),
+          [src]"m"(src), [alpha]"m"(alpha), [k]"m"(k), [shift]"m"(shift)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+#endif /* HAVE_SSE4_INLINE */
+
+av_cold void ff_draw_init_x86(FFDrawContext *draw)
+{
+#if HAVE_SSE4_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE4(cpu_flags)) {
+        draw->blend_row8     = blend_row8_sse4;
+        draw->blend_row8_2x2 = blend_row8_2x2_sse4;
+    }
+#endif
+}
@@ -22,6 +22,9 @@
 #include <stdint.h>
 
 #include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
 #include "libavfilter/vf_hqdn3d.h"
 #include "config.h"
 
@@ -38,8 +41,84 @@ void ff_hqdn3d_row_16_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant,
                           uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial,
                           int16_t *temporal);
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/* lowpass() on 2x8 pixels: prev in ymm1/ymm9, cur in ymm0/ymm8, result in
+ * ymm0/ymm8. The two halves are interleaved to hide the gather latency. */
+#define LOWPASS(coef)                                                       \
+    "vpsubd      %%ymm0, %%ymm1, %%ymm2     \n\t"                           \
+    "vpsubd      %%ymm8, %%ymm9, %%ymm10    \n\t"                           \
+    "vpsrad         $4, %%ymm2, %%ymm2      \n\t"                           \
+    "vpsrad         $4, %%ymm10, %%ymm10    \n\t"                           \
+    "vpcmpeqd    %%ymm3, %%ymm3, %%ymm3     \n\t"                           \
+    "vpcmpeqd    %%ymm11, %%ymm11, %%ymm11  \n\t"                           \
+    "vpgatherdd  %%ymm3, (%" coef ", %%ymm2, 2), %%ymm4   \n\t"             \
+    "vpgatherdd  %%ymm11, (%" coef ", %%ymm10, 2), %%ymm12 \n\t"            \
+    "vpslld        $16, %%ymm4, %%ymm4      \n\t"                           \
+    "vpslld        $16, %%ymm12, %%ymm12    \n\t"                           \
+    "vpsrad        $16, %%ymm4, %%ymm4      \n\t"                           \
+    "vpsrad        $16, %%ymm12, %%ymm12    \n\t"                           \
+    "vpaddd      %%ymm4, %%ymm0, %%ymm0     \n\t"                           \
+    "vpaddd      %%ymm12, %%ymm8, %%ymm8    \n\t"
+
+/* low 16 bits of the 16 dwords of ymm0/ymm8 to ymm1 */
+#define PACK_LOW16                                                          \
+    "vpand       %%ymm5, %%ymm0, %%ymm1     \n\t"                           \
+    "vpand       %%ymm5, %%ymm8, %%ymm9     \n\t"                           \
+    "vpackusdw   %%ymm9, %%ymm1, %%ymm1     \n\t"                           \
+    "vpermq     $0xd8, %%ymm1, %%ymm1       \n\t"
+
+static void vtpass_row_8_avx2(const uint16_t *hpass, uint8_t *dst,
+                              uint16_t *line_ant, uint16_t *frame_ant,
+                              ptrdiff_t w, int16_t *spatial, int16_t *temporal)
+{
+    x86_reg x = -w;
+
+    if (!w)
+        return;
+    __asm__ volatile(
+        "vpcmpeqd    %%ymm5, %%ymm5, %%ymm5     \n\t"
+        "vpsrld        $16, %%ymm5, %%ymm5      \n\t" // 0xffff
+        "1:                                     \n\t"
+        "vpmovzxwd    (%1, %0, 2), %%ymm0       \n\t"
+        "vpmovzxwd  16(%1, %0, 2), %%ymm8       \n\t"
+        "vpmovzxwd    (%3, %0, 2), %%ymm1       \n\t"
+        "vpmovzxwd  16(%3, %0, 2), %%ymm9       \n\t"
+        LOWPASS("5")
+        PACK_LOW16
+        "vmovdqu     %%ymm1, (%3, %0, 2)        \n\t"
+        "vpmovzxwd    (%4, %0, 2), %%ymm1       \n\t"
+        "vpmovzxwd  16(%4, %0, 2), %%ymm9       \n\t"
+        LOWPASS("6")
+        PACK_LOW16
+        "vmovdqu     %%ymm1, (%4, %0, 2)        \n\t"
+        "vpsrlw         $8, %%ymm1, %%ymm1      \n\t"
+        "vextracti128   $1, %%ymm1, %%xmm9      \n\t"
+        "vpackuswb   %%xmm9, %%xmm1, %%xmm1     \n\t"
+        "vmovdqu     %%xmm1, (%2, %0)           \n\t"
+        "add           $16, %0                  \n\t"
+        " jl            1b                      \n\t"
+        "vzeroupper                             \n\t"
+        : "+r"(x)
+        : "r"(hpass + w), "r"(dst + w), "r"(line_ant + w), "r"(frame_ant + w),
+          "r"(spatial), "r"(temporal)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm5", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+                       "%xmm12",)
+          "memory"
+    );
+}
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
 av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
 {
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    /* the horizontal pass is recursive along the row, only the vertical and
+     * temporal passes of the slice threaded path are done 16 pixels at a time */
+    if (INLINE_AVX2(cpu_flags))
+        hqdn3d->vtpass_row[8] = vtpass_row_8_avx2;
+#endif
 #if HAVE_YASM
     hqdn3d->denoise_row[8]  = ff_hqdn3d_row_8_x86;
     hqdn3d->denoise_row[9]  = ff_hqdn3d_row_9_x86;
@@ -0,0 +1,166 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_mpdecimate.h"
+
+/* The blocks overlap by 4 pixels, so a psadbw over 16 bytes at x gives the
+ * SADs of the blocks at x and x+8, and one at x+4 those at x+4 and x+12.
+ * The two accumulators are interleaved into 4 dwords at the end. */
+
+#if HAVE_SSE2_INLINE
+static void sad_row_sse2(const uint8_t *cur, const uint8_t *ref,
+                         ptrdiff_t linesize, int *sad, int nb_blocks)
+{
+    int i;
+
+    for (i = 0; i < nb_blocks; i += 4) {
+        const uint8_t *c = cur + 4 * i, *r = ref + 4 * i;
+        x86_reg h = 8;
+
+        __asm__ volatile(
+            "pxor           %%xmm0, %%xmm0      \n\t"
+            "pxor           %%xmm1, %%xmm1      \n\t"
+            "1:                                 \n\t"
+            "movdqu          (%0), %%xmm2       \n\t"
+            "movdqu         4(%0), %%xmm3       \n\t"
+            "movdqu          (%1), %%xmm4       \n\t"
+            "movdqu         4(%1), %%xmm5       \n\t"
+            "psadbw         %%xmm4, %%xmm2      \n\t"
+            "psadbw         %%xmm5, %%xmm3      \n\t"
+            "paddq          %%xmm2, %%xmm0      \n\t"
+            "paddq          %%xmm3, %%xmm1      \n\t"
+            "add               %4, %0           \n\t"
+            "add               %4, %1           \n\t"
+            "dec               %2               \n\t"
+            " jnz              1b               \n\t"
+            "psllq             $32, %%xmm1      \n\t"
+            "por            %%xmm1, %%xmm0      \n\t"
+            "movdqu         %%xmm0, (%3)        \n\t"
+            : "+r"(c), "+r"(r), "+r"(h)
+            : "r"(sad + i), "r"((x86_reg)linesize)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",
+                           "%xmm3", "%xmm4", "%xmm5",)
+              "memory"
+        );
+    }
+}
+
+static void downscale_row2_sse2(uint8_t *dst, const uint8_t *src,
+                                ptrdiff_t linesize, int w)
+{
+    x86_reg x = -w;
+
+    if (!w)
+        return;
+    __asm__ volatile(
+        "pxor           %%xmm6, %%xmm6      \n\t"
+        "pcmpeqw        %%xmm7, %%xmm7      \n\t"
+        "psrlw             $15, %%xmm7      \n\t" // 1
+        "pcmpeqd        %%xmm5, %%xmm5      \n\t"
+        "psrld             $31, %%xmm5      \n\t"
+        "pslld              $1, %%xmm5      \n\t" // 2
+        "1:                                 \n\t"
+        "movdqu   (%1, %0, 2), %%xmm0       \n\t"
+        "movdqu   (%2, %0, 2), %%xmm1       \n\t"
+        "movdqa         %%xmm0, %%xmm2      \n\t"
+        "movdqa         %%xmm1, %%xmm3      \n\t"
+        "punpcklbw      %%xmm6, %%xmm0      \n\t"
+        "punpckhbw      %%xmm6, %%xmm2      \n\t"
+        "punpcklbw      %%xmm6, %%xmm1      \n\t"
+        "punpckhbw      %%xmm6, %%xmm3      \n\t"
+        "paddw          %%xmm1, %%xmm0      \n\t"
+        "paddw          %%xmm3, %%xmm2      \n\t"
+        "pmaddwd        %%xmm7, %%xmm0      \n\t" // sums of 2x2 pixels
+        "pmaddwd        %%xmm7, %%xmm2      \n\t"
+        "paddd          %%xmm5, %%xmm0      \n\t"
+        "paddd          %%xmm5, %%xmm2      \n\t"
+        "psrld              $2, %%xmm0      \n\t"
+        "psrld              $2, %%xmm2      \n\t"
+        "packssdw       %%xmm2, %%xmm0      \n\t"
+        "packuswb       %%xmm0, %%xmm0      \n\t"
+        "movq           %%xmm0, (%3, %0)    \n\t"
+        "add                $8, %0          \n\t"
+        " jl                1b              \n\t"
+        : "+r"(x)
+        : "r"(src + 2 * w), "r"(src + linesize + 2 * w), "r"(dst + w)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+#endif /* HAVE_SSE2_INLINE */
+
+#if HAVE_AVX2_INLINE && HAVE_SSE2_INLINE
+/* same as sad_row_sse2() on 8 blocks per iteration */
+static void sad_row_avx2(const uint8_t *cur, const uint8_t *ref,
+                         ptrdiff_t linesize, int *sad, int nb_blocks)
+{
+    int i;
+
+    for (i = 0; i + 8 <= nb_blocks; i += 8) {
+        const uint8_t *c = cur + 4 * i, *r = ref + 4 * i;
+        x86_reg h = 8;
+
+        __asm__ volatile(
+            "vpxor          %%ymm0, %%ymm0, %%ymm0  \n\t"
+            "vpxor          %%ymm1, %%ymm1, %%ymm1  \n\t"
+            "1:                                     \n\t"
+            "vmovdqu         (%0), %%ymm2           \n\t"
+            "vmovdqu        4(%0), %%ymm3           \n\t"
+            "vpsadbw         (%1), %%ymm2, %%ymm2   \n\t"
+            "vpsadbw        4(%1), %%ymm3, %%ymm3   \n\t"
+            "vpaddq         %%ymm2, %%ymm0, %%ymm0  \n\t"
+            "vpaddq         %%ymm3, %%ymm1, %%ymm1  \n\t"
+            "add               %4, %0               \n\t"
+            "add               %4, %1               \n\t"
+            "dec               %2                   \n\t"
+            " jnz              1b                   \n\t"
+            "vpsllq            $32, %%ymm1, %%ymm1  \n\t"
+            "vpor           %%ymm1, %%ymm0, %%ymm0  \n\t"
+            "vmovdqu        %%ymm0, (%3)            \n\t"
+            "vzeroupper                             \n\t"
+            : "+r"(c), "+r"(r), "+r"(h)
+            : "r"(sad + i), "r"((x86_reg)linesize)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+              "memory"
+        );
+    }
+    if (i < nb_blocks)
+        sad_row_sse2(cur + 4 * i, ref + 4 * i, linesize, sad + i, nb_blocks - i);
+}
+#endif /* HAVE_AVX2_INLINE && HAVE_SSE2_INLINE */
+
+av_cold void ff_mpdecimate_init_x86(DecimateContext *decimate)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags)) {
+        decimate->sad_row        = sad_row_sse2;
+        decimate->downscale_row2 = downscale_row2_sse2;
+    }
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags))
+        decimate->sad_row = sad_row_avx2;
+#endif
+#endif
+}
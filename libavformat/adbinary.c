@@ -29,6 +29,7 @@
 #include "avformat.h"
 #include "libavutil/avstring.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/opt.h"
 
 #include "adpic.h"
 #include "adffmpeg_errors.h"
@@ -65,6 +66,9 @@ static void audioheader_network2host(struct NetVuAudioData *dst, const uint8_t *
 
 /**
  * MPEG4 or H264 video frame with a Netvu header
+ *
+ * @return 1 if the frame was skipped without being read, because the header
+ *         marks it as a P-frame and its stream discards non-key frames
  */
 static int adbinary_mpeg(AVFormatContext *s,
                          AVPacket *pkt,
@@ -104,6 +108,17 @@ static int adbinary_mpeg(AVFormatContext *s,
     if (n < textSize)
         avio_skip(pb, textSize - n);
 
+    if (vidDat->vid_format == PIC_MODE_MPEG4_411_GOV_P ||
+        vidDat->vid_format == PIC_MODE_H264P) {
+        AVStream *st = ad_get_vstream(s, vidDat->format.target_pixels,
+                                      vidDat->format.target_lines, vidDat->cam,
+                                      vidDat->vid_format, vidDat->title);
+        if (st && st->discard >= AVDISCARD_NONKEY) {
+            avio_skip(pb, vidDat->size);
+            return 1;
+        }
+    }
+
     status = av_get_packet(pb, pkt, vidDat->size);
     if (status < 0)  {
         av_log(s, AV_LOG_ERROR, "%s: av_get_packet (size %d) failed, status %d\n",
@@ -111,7 +126,10 @@ static int adbinary_mpeg(AVFormatContext *s,
         return ADFFMPEG_AD_ERROR_MPEG4_NEW_PACKET;
     }
 
-    if ( (vidDat->vid_format == PIC_MODE_MPEG4_411_I) || (vidDat->vid_format == PIC_MODE_MPEG4_411_GOV_I) )
+    // Only a full header carries the picture mode of this very frame, the
+    // minimal and MIME paths fill vid_format from the stream type
+    if ( (vidDat->vid_format == PIC_MODE_MPEG4_411_I) || (vidDat->vid_format == PIC_MODE_MPEG4_411_GOV_I) ||
+         (vidDat->vid_format == PIC_MODE_H264I) )
         pkt->flags |= AV_PKT_FLAG_KEY;
 
     return errorVal;
@@ -158,7 +176,7 @@ static int adbinary_mpeg_minimal(AVFormatContext *s,
         //if (adDataType == AD_DATATYPE_MININAL_H264)
         //    adContext->streamDatatype = PIC_MODE_H264I;
         //else
-        adContext->streamDatatype = mpegOrH264(AV_RB32(pkt->data));
+        adContext->streamDatatype = mpegOrH264Frame(pkt->data, pkt->size);
     }
     vidDat->vid_format = adContext->streamDatatype;
 
@@ -453,7 +471,7 @@ static int adbinary_read_header(AVFormatContext *s)
     return ad_read_header(s, &adContext->utc_offset);
 }
 
-static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
+static int adbinary_read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     AVIOContext *       pb        = s->pb;
     void *              payload   = NULL;
@@ -463,6 +481,7 @@ static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
     enum AVMediaType    mediaType = AVMEDIA_TYPE_UNKNOWN;
     enum AVCodecID      codecId   = CODEC_ID_NONE;
     int                 data_type, data_channel;
+    int                 skipped   = 0;
     unsigned int        size;
     uint8_t             temp[6];
 
@@ -514,6 +533,7 @@ static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
             case AD_DATATYPE_H264I:
             case AD_DATATYPE_H264P:
                 errorVal = adbinary_mpeg(s, pkt, payload, &txtDat);
+                skipped  = errorVal == 1;
                 break;
             case AD_DATATYPE_MINIMAL_MPEG4:
             //case(AD_DATATYPE_MINIMAL_H264):
@@ -563,7 +583,13 @@ static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
         }
     }
 
-    if (errorVal >= 0)  {
+    if (skipped)  {
+        // No packet was created
+        av_freep(&payload);
+        av_freep(&txtDat);
+        return errorVal;
+    }
+    else if (errorVal >= 0)  {
         errorVal = ad_read_packet(s, pkt, data_channel, mediaType, codecId, payload, txtDat);
     }
     else  {
@@ -590,12 +616,39 @@ static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
     return errorVal;
 }
 
+static int adbinary_read_packet(struct AVFormatContext *s, AVPacket *pkt)
+{
+    int errorVal;
+
+    // Drop the frames the caller discards, e.g. P-frames in trick play.
+    // Frames whose header marks them as such are skipped before being read.
+    while ((errorVal = adbinary_read_frame(s, pkt)) > 0 ||
+           (errorVal >= 0 && ad_discard_packet(s, pkt)))
+        av_free_packet(pkt);
+
+    return errorVal;
+}
+
 static int adbinary_read_close(AVFormatContext *s)
 {
     return 0;
 }
 
 
+#define OFFSET(x) offsetof(AdContext, x)
+static const AVOption options[] = {
+    { "jpeg_dht", "write the Huffman tables into every JPEG frame",
+      OFFSET(jpeg_dht), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass adbinary_demuxer_class = {
+    .class_name = "adbinary demuxer",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_adbinary_demuxer = {
     .name           = "adbinary",
     .long_name      = NULL_IF_CONFIG_SMALL("AD-Holdings video format (binary)"),
@@ -604,5 +657,6 @@ AVInputFormat ff_adbinary_demuxer = {
     .read_header    = adbinary_read_header,
     .read_packet    = adbinary_read_packet,
     .read_close     = adbinary_read_close,
+    .priv_class     = &adbinary_demuxer_class,
     .flags          = AVFMT_TS_DISCONT | AVFMT_VARIABLE_FPS | AVFMT_NO_BYTE_SEEK,
 };
@@ -21,10 +21,13 @@
 
 #include <strings.h>
 
+#include "avc.h"
 #include "internal.h"
 #include "url.h"
 #include "libavutil/avstring.h"
 #include "libavutil/intreadwrite.h"
+#include "libavcodec/get_bits.h"
+#include "libavcodec/golomb.h"
 
 #include "adffmpeg_errors.h"
 #include "adpic.h"
@@ -667,7 +670,9 @@ int ad_read_jpeg(AVFormatContext *s, AVPacket *pkt, struct NetVuImageData *video
                  char **text_data)
 {
     static const int nviSize = NetVuImageDataHeaderSize;
+    AdContext *adContext = s->priv_data;
     AVIOContext *pb = s->pb;
+    int dht = !adContext || adContext->jpeg_dht;
     int hdrSize;
     char jfif[2048], *ptr;
     int n, textSize, errorVal = 0;
@@ -716,7 +721,7 @@ int ad_read_jpeg(AVFormatContext *s, AVPacket *pkt, struct NetVuImageData *video
     (*text_data)[textSize] = '\0';
 
     // Use the struct NetVuImageData struct to build a JFIF header
-    if ((hdrSize = build_jpeg_header( jfif, video_data, 2048)) <= 0)  {
+    if ((hdrSize = build_jpeg_header( jfif, video_data, 2048, dht)) <= 0)  {
         av_log(s, AV_LOG_ERROR, "%s: build_jpeg_header failed\n", __func__);
         return ADFFMPEG_AD_ERROR_JPEG_HEADER;
     }
@@ -989,6 +994,91 @@ static int addSideData(AVFormatContext *s, AVPacket *pkt,
     return 0;
 }
     
+/**
+ * Tell whether the H.264 slice NAL unit starting at nal is an I or SI slice.
+ */
+static int ad_h264_is_intra_slice(const uint8_t *nal, const uint8_t *end)
+{
+    GetBitContext gb;
+    unsigned slice_type;
+
+    if (end - nal < 2 || init_get_bits8(&gb, nal + 1, FFMIN(end - nal - 1, 8)) < 0)
+        return 0;
+    get_ue_golomb_long(&gb); // first_mb_in_slice
+    slice_type = get_ue_golomb_31(&gb);
+    return slice_type <= 9 && (slice_type % 5 == 2 || slice_type % 5 == 4);
+}
+
+/**
+ * Set the key frame flag of an MPEG-4 or H.264 frame from its bitstream,
+ * and if the stream has no extradata yet, export the headers preceding the
+ * first picture: VOS/VO/VOL for MPEG-4, SPS and PPS for H.264. This lets
+ * stream copy produce files with a usable index.
+ */
+static int ad_parse_video_frame(AVFormatContext *s, AVStream *st, AVPacket *pkt)
+{
+    const uint8_t *end = pkt->data + pkt->size;
+    const uint8_t *p   = ff_avc_find_startcode(pkt->data, end);
+    const uint8_t *hdr_start = NULL, *hdr_end = NULL;
+    int is_h264 = st->codec->codec_id == CODEC_ID_H264;
+    int has_sps = 0, has_pps = 0;
+
+    while (p < end) {
+        const uint8_t *start = p, *nal;
+        int type;
+
+        while (p < end && !*p)
+            p++;
+        if (++p >= end)
+            break;
+        nal = p;
+
+        if (is_h264) {
+            type = nal[0] & 0x1f;
+            if (type >= 1 && type <= 5) {
+                // First slice, the rest is picture data. Besides IDRs, an
+                // I slice that follows an SPS starts a decodable picture.
+                if (type == 5 || (has_sps && ad_h264_is_intra_slice(nal, end)))
+                    pkt->flags |= AV_PKT_FLAG_KEY;
+                hdr_end = start;
+                break;
+            }
+            if (type == 7 || type == 8) {
+                if (!hdr_start)
+                    hdr_start = start;
+                has_sps |= type == 7;
+                has_pps |= type == 8;
+            }
+        } else {
+            type = nal[0];
+            if (type == 0xB6 || type == 0xB3) {
+                // VOP or GOV: coding type 0 is an I-VOP, a GOV precedes one
+                if (type == 0xB3 || (nal + 1 < end && !(nal[1] >> 6)))
+                    pkt->flags |= AV_PKT_FLAG_KEY;
+                hdr_end = start;
+                break;
+            }
+            if (type >= 0x20 && type <= 0x2F) {
+                hdr_start = pkt->data;
+                has_sps = has_pps = 1;
+            }
+        }
+        p = ff_avc_find_startcode(nal, end);
+    }
+
+    if (!st->codec->extradata && has_sps && has_pps && hdr_end > hdr_start) {
+        int size = hdr_end - hdr_start;
+        st->codec->extradata = av_mallocz(size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!st->codec->extradata)
+            return AVERROR(ENOMEM);
+        memcpy(st->codec->extradata, hdr_start, size);
+        st->codec->extradata_size = size;
+        av_log(s, AV_LOG_DEBUG, "%s: %d bytes of extradata for stream %d\n",
+               __func__, size, st->index);
+    }
+    return 0;
+}
+
 int ad_read_packet(AVFormatContext *s, AVPacket *pkt, int channel, 
                    enum AVMediaType media, enum AVCodecID codecId, 
                    void *data, char *text)
@@ -1039,6 +1129,17 @@ int ad_read_packet(AVFormatContext *s, AVPacket *pkt, int channel,
                 adContext->metadataSet = 1;
             }
 
+            if (st->codec->codec_id == CODEC_ID_MPEG4 ||
+                st->codec->codec_id == CODEC_ID_H264) {
+                int ret;
+                if ((ret = ad_parse_video_frame(s, st, pkt)) < 0) {
+                    av_free_packet(pkt);
+                    return ret;
+                }
+            }
+            else
+                pkt->flags |= AV_PKT_FLAG_KEY;
+
             addSideData(s, pkt, media, sizeof(struct NetVuImageData), data, text);
         }
     }
@@ -1078,11 +1179,39 @@ int ad_read_packet(AVFormatContext *s, AVPacket *pkt, int channel,
     return 0;
 }
 
+/**
+ * Trick play support: tell whether a packet returned by ad_read_packet()
+ * should be dropped, following the discard setting of its stream. With
+ * AVDISCARD_NONKEY or above only the key frames of a video stream are kept,
+ * which lets players skip through recordings without decoding P-frames.
+ */
+int ad_discard_packet(AVFormatContext *s, const AVPacket *pkt)
+{
+    AVStream *st;
+
+    if (pkt->stream_index < 0 || pkt->stream_index >= s->nb_streams)
+        return 0;
+    st = s->streams[pkt->stream_index];
+
+    if (st->discard >= AVDISCARD_ALL)
+        return 1;
+    return st->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+           st->discard >= AVDISCARD_NONKEY && !(pkt->flags & AV_PKT_FLAG_KEY);
+}
+
+/**
+ * Convert an ADPCM block to the IMA WAV layout: byte swap the predictor and
+ * swap the nibbles of the samples. dest may be equal to src.
+ */
 void audiodata_network2host(uint8_t *dest, const uint8_t *src, int size)
 {
     const uint8_t *dataEnd = src + size;
-    
-    uint16_t predictor = AV_RB16(src);
+    uint16_t predictor;
+
+    if (size < 4)
+        return;
+
+    predictor = AV_RB16(src);
     src += 2;
 
     AV_WL16(dest, predictor);
@@ -1091,9 +1220,14 @@ void audiodata_network2host(uint8_t *dest, const uint8_t *src, int size)
     *dest++ = *src++;
     *dest++ = *src++;
 
-    for (;src < dataEnd; src++, dest++)  {
-        *dest = (((*src) & 0xF0) >> 4) | (((*src) & 0x0F) << 4);
+    // Swap the nibbles of 8 bytes at once, the byte order doesn't matter
+    for (; dataEnd - src >= 8; src += 8, dest += 8) {
+        uint64_t v = AV_RN64(src);
+        AV_WN64(dest, (v >> 4 & 0x0F0F0F0F0F0F0F0FULL) |
+                      (v & 0x0F0F0F0F0F0F0F0FULL) << 4);
     }
+    for (; src < dataEnd; src++, dest++)
+        *dest = *src >> 4 | *src << 4;
 }
 
 int mpegOrH264(unsigned int startCode)
@@ -1103,3 +1237,25 @@ int mpegOrH264(unsigned int startCode)
     else
         return PIC_MODE_H264I;
 }
+
+/**
+ * Tell MPEG-4 from H.264 using a whole frame: every MPEG-4 frame has a VOP
+ * start code, and 0xB6 can't be an H.264 NAL header as it has the
+ * forbidden bit set.
+ */
+int mpegOrH264Frame(const uint8_t *data, int size)
+{
+    const uint8_t *end = data + size;
+    const uint8_t *p   = ff_avc_find_startcode(data, end);
+
+    while (p < end) {
+        while (p < end && !*p)
+            p++;
+        if (++p >= end)
+            break;
+        if (*p == 0xB6)
+            return PIC_MODE_MPEG4_411;
+        p = ff_avc_find_startcode(p, end);
+    }
+    return PIC_MODE_H264I;
+}
@@ -177,9 +177,13 @@ static int q_init;
  * \param pic  Pointer to NetVuImageData - includes Q factors, image size,
  *             mode etc.
  * \param max  Maximum size of header
+ * \param dht  Include the Huffman tables. The cameras always use the
+ *             standard tables, so they can be left out (as in MJPEG/AVI1)
+ *             and restored later with the mjpeg2jpeg bitstream filter
  * \return Total bytes in the JFIF image
  */
-unsigned int build_jpeg_header(void *jfif, struct NetVuImageData *pic, unsigned int max)
+unsigned int build_jpeg_header(void *jfif, struct NetVuImageData *pic, unsigned int max,
+                               int dht)
 {
     volatile unsigned int count;
     unsigned short    us1;
@@ -222,7 +226,9 @@ unsigned int build_jpeg_header(void *jfif, struct NetVuImageData *pic, unsigned
     *bufptr++ = 0x01;
     for (us1 = 0; us1 < 64; us1++)
         *bufptr++ = UVQuantizationFactors[pic->factor][us1];
-    count += (sizeof(sof_copy) + sizeof(huf_header) + sizeof(sos_header));
+    count += sizeof(sof_copy) + sizeof(sos_header);
+    if (dht)
+        count += sizeof(huf_header);
     if (count > max)
         return 0;
     else {
@@ -244,8 +250,10 @@ unsigned int build_jpeg_header(void *jfif, struct NetVuImageData *pic, unsigned
         memcpy(bufptr, sof_copy, sizeof(sof_copy));
         bufptr += sizeof(sof_copy);
 
-        memcpy(bufptr, huf_header, sizeof(huf_header));
-        bufptr += sizeof(huf_header);
+        if (dht) {
+            memcpy(bufptr, huf_header, sizeof(huf_header));
+            bufptr += sizeof(huf_header);
+        }
 
         memcpy(bufptr, sos_header, sizeof(sos_header));
         bufptr += sizeof(sos_header);
@@ -33,7 +33,7 @@
 #include "ds_exports.h"
 
 extern unsigned int build_jpeg_header(void *jfif, struct NetVuImageData *pic,
-                                      unsigned int max);
+                                      unsigned int max, int dht);
 extern int parse_jfif(AVFormatContext *s, unsigned char *data,
                       struct NetVuImageData *pic, int imgSize, char **text);
 
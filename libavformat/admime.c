@@ -30,10 +30,11 @@
 #include "adpic.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
+#include "libavutil/opt.h"
 
 
 #define TEMP_BUFFER_SIZE        1024
-#define MAX_IMAGE_SIZE          (256 * 1024)
+#define MAX_IMAGE_SIZE          (64 * 1024 * 1024)
 
 // This value is only used internally within the library DATA_PLAINTEXT blocks
 // should not be exposed to the client
@@ -519,7 +520,7 @@ static int admime_mpeg(AVFormatContext *s,
         else if (adDataType == AD_DATATYPE_H264P)
             adContext->streamDatatype = PIC_MODE_H264P;
         else
-            adContext->streamDatatype = mpegOrH264(AV_RB32(pkt->data));
+            adContext->streamDatatype = mpegOrH264Frame(pkt->data, pkt->size);
     }
     vidDat->vid_format = adContext->streamDatatype;
 
@@ -596,47 +597,85 @@ static int ad_read_audio(AVFormatContext *s,
  *
  * However sometimes the header is missing and then there is a valid image so
  * try and parse a frame out anyway.
+ *
+ * The data is scanned for the end of image marker directly in the I/O buffer
+ * and appended to the packet a buffer at a time. The packet starts with the
+ * size of the previous image, so that it rarely has to grow.
  */
 static int handleInvalidMime(AVFormatContext *s,
                              uint8_t *preRead, int preReadSize, AVPacket *pkt,
                              int *data_type, int *size, int *imgLoaded)
 {
+    AdContext *adContext = s->priv_data;
     AVIOContext *pb = s->pb;
-    int errorVal = 0;
-    unsigned char chkByte;
-    int status, read, found = FALSE;
-    uint8_t imageData[MAX_IMAGE_SIZE];
-
-    for(read = 0; read < preReadSize; read++)  {
-        imageData[read] = preRead[read];
-    }
+    int status, len = preReadSize, found = FALSE, chkByte = 0;
+    int allocSize = FFMAX(adContext->rawJfifSize, preReadSize + TEMP_BUFFER_SIZE);
+    int prevFF = preReadSize > 0 && preRead[preReadSize - 1] == 0xFF;
 
     //Set the data type
     *data_type = AD_DATATYPE_JFIF;
 
-    // Read more data till we find end of image marker
-    for (; !found && (pb->eof_reached==0) && (pb->error==0); read++) {
-        if (read >= MAX_IMAGE_SIZE)
-            return ADFFMPEG_AD_ERROR_PARSE_MIME_HEADER;
-
-        if (avio_read(pb, &chkByte, 1) < 0)
-            break;
-        imageData[read] = chkByte;
-        if(imageData[read - 1] == 0xFF && imageData[read] == 0xD9)
-            found = TRUE;
-    }
-
-    *size = read;
-    if ((status = ad_new_packet(pkt, *size)) < 0) {
+    if ((status = ad_new_packet(pkt, allocSize)) < 0) {
         av_log(s, AV_LOG_ERROR, "handleInvalidMime: ad_new_packet (size %d)"
-                                " failed, status %d\n", *size, status);
+                                " failed, status %d\n", allocSize, status);
         return ADFFMPEG_AD_ERROR_NEW_PACKET;
     }
+    memcpy(pkt->data, preRead, preReadSize);
+
+    // Read more data till we find end of image marker
+    while (!found) {
+        const uint8_t *start = pb->buf_ptr, *end = pb->buf_end, *p = start;
+        int n;
+
+        if (start >= end) {
+            // Refill the I/O buffer through a single byte read
+            chkByte = avio_r8(pb);
+            if (pb->eof_reached || pb->error)
+                break;
+            found  = prevFF && chkByte == 0xD9;
+            prevFF = chkByte == 0xFF;
+            start  = NULL;
+            n      = 1;
+        } else {
+            if (prevFF && *p == 0xD9) {
+                p++;
+                found = TRUE;
+            }
+            while (!found && (p = memchr(p, 0xFF, end - p)) && p + 1 < end) {
+                if (p[1] == 0xD9)
+                    found = TRUE;
+                p += 2 - (p[1] == 0xFF);
+            }
+            if (!found)
+                p = end;
+            n      = p - start;
+            prevFF = !found && end[-1] == 0xFF;
+        }
+
+        if (len + n > MAX_IMAGE_SIZE) {
+            av_free_packet(pkt);
+            return ADFFMPEG_AD_ERROR_PARSE_MIME_HEADER;
+        }
+        if (len + n > pkt->size &&
+            (status = av_grow_packet(pkt, FFMAX(n, pkt->size))) < 0) {
+            av_log(s, AV_LOG_ERROR, "handleInvalidMime: av_grow_packet failed,"
+                                    " status %d\n", status);
+            av_free_packet(pkt);
+            return ADFFMPEG_AD_ERROR_NEW_PACKET;
+        }
+        if (start)
+            avio_read(pb, pkt->data + len, n);
+        else
+            pkt->data[len] = chkByte;
+        len += n;
+    }
 
-    memcpy(pkt->data, imageData, *size);
+    av_shrink_packet(pkt, len);
+    adContext->rawJfifSize = len;
+    *size = len;
     *imgLoaded = TRUE;
 
-    return errorVal;
+    return 0;
 }
 
 
@@ -809,6 +848,20 @@ static int admime_read_close(AVFormatContext *s)
 }
 
 
+#define OFFSET(x) offsetof(AdContext, x)
+static const AVOption options[] = {
+    { "jpeg_dht", "write the Huffman tables into every JPEG frame",
+      OFFSET(jpeg_dht), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass admime_demuxer_class = {
+    .class_name = "admime demuxer",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_admime_demuxer = {
     .name           = "admime",
     .long_name      = NULL_IF_CONFIG_SMALL("AD-Holdings video format (MIME)"),
@@ -817,5 +870,6 @@ AVInputFormat ff_admime_demuxer = {
     .read_header    = admime_read_header,
     .read_packet    = admime_read_packet,
     .read_close     = admime_read_close,
+    .priv_class     = &admime_demuxer_class,
     .flags          = AVFMT_TS_DISCONT | AVFMT_VARIABLE_FPS | AVFMT_NO_BYTE_SEEK,
 };
@@ -66,10 +66,13 @@ enum ff_ad_data_type {  AD_DATATYPE_JPEG = 0,
                       };
 
 typedef struct {
+    const AVClass *class;
     int64_t lastVideoPTS;
     int     utc_offset;     ///< Only used in minimal video case
     int     metadataSet;
     enum ff_ad_data_type streamDatatype;
+    int     jpeg_dht;       ///< Write the Huffman tables into JPEG frames
+    int     rawJfifSize;    ///< Size of the last image without MIME header
 } AdContext;
 
 
@@ -85,12 +88,14 @@ int ad_read_overlay(AVFormatContext *s, AVPacket *pkt, int channel, int size, ch
 int ad_read_packet(AVFormatContext *s, AVPacket *pkt, int channel,
                    enum AVMediaType mediaType, enum AVCodecID codecId, 
                    void *data, char *text_data);
+int ad_discard_packet(AVFormatContext *s, const AVPacket *pkt);
 AVStream * ad_get_vstream(AVFormatContext *s, uint16_t w, uint16_t h,
                           uint8_t cam, int format, const char *title);
 AVStream * ad_get_audio_stream(AVFormatContext *s, struct NetVuAudioData* audioHeader);
 void audiodata_network2host(uint8_t *data, const uint8_t *src, int size);
 int ad_adFormatToCodecId(AVFormatContext *s, int32_t adFormat);
 int mpegOrH264(unsigned int startCode);
+int mpegOrH264Frame(const uint8_t *data, int size);
 int ad_pbmDecompress(char **comment, uint8_t **src, int size, AVPacket *pkt, int *width, int *height);
 
 
@@ -792,6 +792,14 @@ int ffio_ensure_seekback(AVIOContext *s, int buf_size)
     return 0;
 }
 
+URLContext *ffio_geturlcontext(AVIOContext *s)
+{
+    if ((void*)s->write_packet == (void*)ffurl_write ||
+        (void*)s->read_packet  == (void*)ffurl_read)
+        return s->opaque;
+    return NULL;
+}
+
 int ffio_set_buf_size(AVIOContext *s, int buf_size)
 {
     uint8_t *buffer;
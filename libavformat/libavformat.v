@@ -21,6 +21,9 @@ LIBAVFORMAT_$MAJOR {
                 ffurl_size;
                 ffurl_write;
                 ffurl_protocol_next;
+                #those are for tools/udpbench
+                ffurl_read;
+                ff_udp_flush;
                 url_open;
                 url_close;
                 url_write;
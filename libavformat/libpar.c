@@ -868,6 +868,28 @@ static int par_read_header(AVFormatContext * avf)
     return 0;
 }
 
+/**
+ * Trick play support: tell whether the frame just loaded should be skipped
+ * before it is copied into a packet, following the discard setting of its
+ * stream. With AVDISCARD_NONKEY or above only the I-frames are returned.
+ */
+static int par_discard_frame(AVFormatContext *avf, ParFrameInfo *fi)
+{
+    int ii;
+
+    for(ii = 0; ii < avf->nb_streams; ii++)  {
+        AVStream *st = avf->streams[ii];
+        if ( (NULL != st) && (st->id == fi->channel) )  {
+            if (st->discard >= AVDISCARD_ALL)
+                return 1;
+            return (st->discard >= AVDISCARD_NONKEY) &&
+                   parReader_frameIsVideo(fi) && !parReader_isIFrame(fi);
+        }
+    }
+    // Not seen yet, keep it so that the stream gets created
+    return 0;
+}
+
 static int par_read_packet(AVFormatContext * avf, AVPacket * pkt)
 {
     PARDecContext *p = avf->priv_data;
@@ -879,6 +901,14 @@ static int par_read_packet(AVFormatContext * avf, AVPacket * pkt)
     else
         siz = parReader_loadFrame(&p->frameInfo, &p->dispSet, &p->fileChanged);
 
+    while ( (siz > 0) && (NULL != p->frameInfo.frameData) &&
+            par_discard_frame(avf, &p->frameInfo) )  {
+        // Report a file change that happened on a skipped frame
+        int fileChanged = p->fileChanged;
+        siz = parReader_loadFrame(&p->frameInfo, &p->dispSet, &p->fileChanged);
+        p->fileChanged |= fileChanged;
+    }
+
     if (siz < 0)  {
         p->frameCached = 0;
         p->fileChanged = 0;
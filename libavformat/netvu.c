@@ -28,6 +28,7 @@
 #include "http.h"
 #include "netvu.h"
 #include "libavutil/avstring.h"
+#include "libavutil/opt.h"
 
 
 static void copy_value_to_field(const char *value, char **dest)
@@ -127,6 +128,25 @@ static void processLine(char *line, NetvuContext *nv)
         copy_value_to_field( p, &nv->hdrs[NETVU_SERVER]);
 }
 
+/**
+ * Find the demuxer for the content type sent by the server, so that the
+ * stream does not have to be probed.
+ */
+static const char *netvu_format_name(const NetvuContext *nv)
+{
+    const char *type = nv->hdrs[NETVU_CONTENT];
+
+    if (!type)
+        return NULL;
+    // Server push of MIME parts, or single JPEG images without header
+    if (av_stristart(type, "multipart/", NULL) ||
+        !av_strcasecmp(type, "image/jpeg"))
+        return "admime";
+    if (!av_strcasecmp(type, "application/octet-stream"))
+        return "adbinary";
+    return NULL;
+}
+
 static int netvu_open(URLContext *h, const char *uri, int flags)
 {
     char hostname[1024], auth[1024], path[1024], http[1024];
@@ -168,6 +188,8 @@ static int netvu_open(URLContext *h, const char *uri, int flags)
                 }
             }
         }
+        if (netvu_format_name(nv))
+            nv->format_name = av_strdup(netvu_format_name(nv));
         return 0;
     }
     else  {
@@ -194,14 +216,36 @@ static int netvu_close(URLContext *h)
     if (nv->hd)
         ret = ffurl_close(nv->hd);
 
-    for (i = 0; i < NETVU_MAX_HEADERS; i++)  {
-        if (nv->hdrs[i])
-            av_free(nv->hdrs[i]);
-    }
+    for (i = 0; i < NETVU_MAX_HEADERS; i++)
+        av_freep(&nv->hdrs[i]);
+    av_freep(&nv->format_name);
 
     return ret;
 }
 
+#define OFFSET(x) offsetof(NetvuContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+#define EXPORT (D | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY)
+static const AVOption options[] = {
+    { "mime_type",   "export the content type sent by the server", OFFSET(hdrs[NETVU_CONTENT]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "format_name", "export the name of the demuxer for the content type", OFFSET(format_name), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "server",      "export the server name", OFFSET(hdrs[NETVU_SERVER]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "resolution",  "export the stream resolution", OFFSET(hdrs[NETVU_RESOLUTION]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "compression", "export the stream compression", OFFSET(hdrs[NETVU_COMPRESSION]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "rate",        "export the stream rate", OFFSET(hdrs[NETVU_RATE]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "pps",         "export the pictures per second", OFFSET(hdrs[NETVU_PPS]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "site_id",     "export the site identifier", OFFSET(hdrs[NETVU_SITE_ID]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { "boundary",    "export the MIME boundary", OFFSET(hdrs[NETVU_BOUNDARY]), AV_OPT_TYPE_STRING, { 0 }, 0, 0, EXPORT },
+    { NULL }
+};
+
+static const AVClass netvu_context_class = {
+    .class_name = "netvu",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 
 URLProtocol ff_netvu_protocol = {
     .name               = "netvu",
@@ -209,5 +253,6 @@ URLProtocol ff_netvu_protocol = {
     .url_read            = netvu_read,
     .url_close           = netvu_close,
     .priv_data_size      = sizeof(NetvuContext),
+    .priv_data_class     = &netvu_context_class,
     .flags               = URL_PROTOCOL_FLAG_NETWORK,
 };
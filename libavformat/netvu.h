@@ -18,4 +18,5 @@ typedef struct {
     char* hdrs[NETVU_MAX_HEADERS];
     const char* hdrNames[NETVU_MAX_HEADERS];
     int utc_offset;
+    char *format_name;  ///< Demuxer matching the content type, if known
 } NetvuContext;
@@ -511,6 +511,20 @@ RTPDemuxContext *ff_rtp_parse_open(AVFormatContext *s1, AVStream *st,
     s->ic                  = s1;
     s->st                  = st;
     s->queue_size          = queue_size;
+    if (queue_size > 1) {
+        int i;
+        s->packet_pool = av_mallocz_array(queue_size, sizeof(*s->packet_pool));
+        s->spare_bufs  = av_mallocz_array(queue_size, sizeof(*s->spare_bufs));
+        if (!s->packet_pool || !s->spare_bufs) {
+            av_free(s->packet_pool);
+            av_free(s->spare_bufs);
+            av_free(s);
+            return NULL;
+        }
+        for (i = 0; i < queue_size - 1; i++)
+            s->packet_pool[i].next = &s->packet_pool[i + 1];
+        s->free_packets = s->packet_pool;
+    }
     rtp_init_statistics(&s->statistics, 0);
     if (st) {
         switch (st->codec->codec_id) {
@@ -665,35 +679,71 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
     return rv;
 }
 
+/**
+ * Return the buffer of a dequeued packet to the spare list, so that it
+ * can be handed back to the caller instead of allocating a new one.
+ */
+static void recycle_buffer(RTPDemuxContext *s, uint8_t *buf)
+{
+    if (s->nb_spare_bufs < s->queue_size)
+        s->spare_bufs[s->nb_spare_bufs++] = buf;
+    else
+        av_free(buf);
+}
+
+static RTPPacket *dequeue_packet(RTPDemuxContext *s)
+{
+    RTPPacket *packet = s->queue;
+
+    s->queue = packet->next;
+    if (!s->queue)
+        s->queue_tail = NULL;
+    s->queue_len--;
+    packet->next    = s->free_packets;
+    s->free_packets = packet;
+    return packet;
+}
+
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_free(s->queue->buf);
-        av_free(s->queue);
-        s->queue = next;
-    }
+    while (s->queue)
+        recycle_buffer(s, dequeue_packet(s)->buf);
     s->seq       = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
 }
 
-static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+/**
+ * Insert a packet into the reordering queue, taking ownership of *bufptr.
+ * A previously dequeued buffer is returned in *bufptr if one is available,
+ * NULL otherwise.
+ */
+static void enqueue_packet(RTPDemuxContext *s, uint8_t **bufptr, int len)
 {
+    uint8_t *buf   = *bufptr;
     uint16_t seq   = AV_RB16(buf + 2);
     RTPPacket **cur = &s->queue, *packet;
 
-    /* Find the correct place in the queue to insert the packet */
-    while (*cur) {
-        int16_t diff = seq - (*cur)->seq;
-        if (diff < 0)
-            break;
-        cur = &(*cur)->next;
-    }
-
-    packet = av_mallocz(sizeof(*packet));
+    packet = s->free_packets;
     if (!packet)
         return;
+    s->free_packets = packet->next;
+
+    if (!s->queue_tail || (int16_t)(seq - s->queue_tail->seq) >= 0) {
+        /* In-order arrival, append after the last queued packet */
+        cur = s->queue_tail ? &s->queue_tail->next : &s->queue;
+        s->queue_tail = packet;
+    } else {
+        /* Find the correct place in the queue to insert the packet */
+        while (*cur) {
+            int16_t diff = seq - (*cur)->seq;
+            if (diff < 0)
+                break;
+            cur = &(*cur)->next;
+        }
+        s->reordered_packets++;
+    }
+
     packet->recvtime = av_gettime();
     packet->seq      = seq;
     packet->len      = len;
@@ -701,6 +751,8 @@ static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
     packet->next     = *cur;
     *cur = packet;
     s->queue_len++;
+
+    *bufptr = s->nb_spare_bufs ? s->spare_bufs[--s->nb_spare_bufs] : NULL;
 }
 
 static int has_next_packet(RTPDemuxContext *s)
@@ -716,22 +768,22 @@ int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
     int rv;
-    RTPPacket *next;
+    RTPPacket *packet;
 
     if (s->queue_len <= 0)
         return -1;
 
-    if (!has_next_packet(s))
+    if (!has_next_packet(s)) {
+        uint16_t missed = s->queue->seq - s->seq - 1;
         av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+               "RTP: missed %d packets\n", missed);
+        s->lost_packets += missed;
+    }
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_free(s->queue->buf);
-    av_free(s->queue);
-    s->queue = next;
-    s->queue_len--;
+    packet = dequeue_packet(s);
+    rv     = rtp_parse_packet_internal(s, pkt, packet->buf, packet->len);
+    recycle_buffer(s, packet->buf);
     return rv;
 }
 
@@ -791,15 +843,17 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
             /* Packet older than the previously emitted one, drop */
             av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
                    "RTP: dropping old packet received too late\n");
+            s->late_packets++;
             return -1;
         } else if (diff <= 1) {
             /* Correct packet */
+            if (diff == 1 && s->queue)
+                s->reordered_packets++;
             rv = rtp_parse_packet_internal(s, pkt, buf, len);
             return rv;
         } else {
             /* Still missing some packet, enqueue this one. */
-            enqueue_packet(s, buf, len);
-            *bufptr = NULL;
+            enqueue_packet(s, bufptr, len);
             /* Return the first enqueued packet if the queue is full,
              * even if we're missing something */
             if (s->queue_len >= s->queue_size)
@@ -813,7 +867,10 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
  * Parse an RTP or RTCP packet directly sent as a buffer.
  * @param s RTP parse context.
  * @param pkt returned packet
- * @param bufptr pointer to the input buffer or NULL to read the next packets
+ * @param bufptr pointer to the input buffer or NULL to read the next packets.
+ *               If the packet is queued for reordering, ownership of the
+ *               buffer is taken and *bufptr is replaced by NULL or by a
+ *               buffer of the same size passed in earlier.
  * @param len buffer len
  * @return 0 if a packet is returned, 1 if a packet is returned and more can follow
  * (use buf as NULL to read the next). -1 if no packet (error or no more packet).
@@ -834,6 +891,10 @@ int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 void ff_rtp_parse_close(RTPDemuxContext *s)
 {
     ff_rtp_reset_packet_queue(s);
+    while (s->nb_spare_bufs)
+        av_free(s->spare_bufs[--s->nb_spare_bufs]);
+    av_free(s->spare_bufs);
+    av_free(s->packet_pool);
     ff_srtp_free(&s->srtp);
     av_free(s);
 }
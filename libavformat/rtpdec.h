@@ -168,8 +168,19 @@ struct RTPDemuxContext {
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
     RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket* queue_tail;   ///< The last packet in queue
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    RTPPacket *packet_pool;  ///< queue_size preallocated queue entries
+    RTPPacket *free_packets; ///< Unused entries of packet_pool
+    uint8_t **spare_bufs;    ///< Buffers of dequeued packets, ready for reuse
+    int nb_spare_bufs;       ///< The number of buffers in spare_bufs
+    /*@}*/
+
+    /** Reordering statistics @{ */
+    int64_t late_packets;      ///< Packets dropped because they arrived too late
+    int64_t lost_packets;      ///< Packets given up on when the queue was full
+    int64_t reordered_packets; ///< Packets received after a later one
     /*@}*/
 
     /* rtcp sender statistics receive */
@@ -20,8 +20,11 @@
  */
 
 #include "avformat.h"
+#include "avio_internal.h"
 #include "mpegts.h"
 #include "internal.h"
+#include "rtpproto.h"
+#include "url.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/random_seed.h"
 #include "libavutil/opt.h"
@@ -492,7 +495,7 @@ static int rtp_send_ilbc(AVFormatContext *s1, const uint8_t *buf, int size)
     return 0;
 }
 
-static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
+static int rtp_send_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     RTPMuxContext *s = s1->priv_data;
     AVStream *st = s1->streams[0];
@@ -602,6 +605,31 @@ static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Send the RTP packets the protocol may have queued to send them in a
+ * single batch, see the send_batch option of the udp and rtp protocols.
+ */
+static int rtp_flush_queued(AVFormatContext *s1)
+{
+    URLContext *h = s1->pb ? ffio_geturlcontext(s1->pb) : NULL;
+
+    if (!h || !h->prot)
+        return 0;
+    if (CONFIG_RTP_PROTOCOL && !strcmp(h->prot->name, "rtp"))
+        return ff_rtp_flush(h);
+    if (CONFIG_UDP_PROTOCOL && !strcmp(h->prot->name, "udp"))
+        return ff_udp_flush(h);
+    return 0;
+}
+
+static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    int ret = rtp_send_packet(s1, pkt);
+    int err = rtp_flush_queued(s1);
+
+    return ret < 0 ? ret : err;
+}
+
 static int rtp_write_trailer(AVFormatContext *s1)
 {
     RTPMuxContext *s = s1->priv_data;
@@ -24,6 +24,8 @@
  * RTP protocol
  */
 
+#define _GNU_SOURCE     /* Needed for recvmmsg() with glibc */
+
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
 #include "avformat.h"
@@ -41,6 +43,9 @@
 #include <sys/poll.h>
 #endif
 
+#define RTP_MAX_PKT_SIZE 65536
+#define RTP_MAX_RECV_BATCH 256
+
 typedef struct RTPContext {
     URLContext *rtp_hd, *rtcp_hd;
     int rtp_fd, rtcp_fd, nb_ssm_include_addrs, nb_ssm_exclude_addrs;
@@ -48,6 +53,17 @@ typedef struct RTPContext {
     int write_to_source;
     struct sockaddr_storage last_rtp_source, last_rtcp_source;
     socklen_t last_rtp_source_len, last_rtcp_source_len;
+    int recv_batch;
+#if HAVE_RECVMMSG
+    /* RTP datagrams received by a single recvmmsg() call, returned one at
+     * a time by rtp_read() */
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_storage *addrs;
+    uint8_t *batch_buf;
+    int batch_slot_size;
+    int nb_batched, batch_next;
+#endif
 } RTPContext;
 
 /**
@@ -192,6 +208,7 @@ static void build_udp_url(char *buf, int buf_size,
                           const char *hostname, int port,
                           int local_port, int ttl,
                           int max_packet_size, int connect,
+                          int send_batch,
                           const char *include_sources,
                           const char *exclude_sources)
 {
@@ -204,6 +221,8 @@ static void build_udp_url(char *buf, int buf_size,
         url_add_option(buf, buf_size, "pkt_size=%d", max_packet_size);
     if (connect)
         url_add_option(buf, buf_size, "connect=1");
+    if (send_batch > 1)
+        url_add_option(buf, buf_size, "send_batch=%d", send_batch);
     url_add_option(buf, buf_size, "fifo_size=0");
     if (include_sources && include_sources[0])
         url_add_option(buf, buf_size, "sources=%s", include_sources);
@@ -262,6 +281,7 @@ static void rtp_parse_addr_list(URLContext *h, char *buf,
  *         'sources=ip[,ip]'  : list allowed source IP addresses
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
+ *         'send_batch=n'     : send up to n RTP packets with a single system call
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -271,11 +291,21 @@ static void rtp_parse_addr_list(URLContext *h, char *buf,
  * if the local rtcp port is not set it will be the local rtp port + 1
  */
 
+static void rtp_free_batch(RTPContext *s)
+{
+#if HAVE_RECVMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->addrs);
+    av_freep(&s->batch_buf);
+#endif
+}
+
 static int rtp_open(URLContext *h, const char *uri, int flags)
 {
     RTPContext *s = h->priv_data;
     int rtp_port, rtcp_port,
-        ttl, connect,
+        ttl, connect, send_batch,
         local_rtp_port, local_rtcp_port, max_packet_size;
     char hostname[256], include_sources[1024] = "", exclude_sources[1024] = "";
     char buf[1024];
@@ -292,6 +322,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     local_rtcp_port = -1;
     max_packet_size = -1;
     connect = 0;
+    send_batch = 0;
 
     p = strchr(uri, '?');
     if (p) {
@@ -316,9 +347,19 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "connect", p)) {
             connect = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            send_batch = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "write_to_source", p)) {
             s->write_to_source = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 1, RTP_MAX_RECV_BATCH);
+            if (!HAVE_RECVMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'recv_batch' option was set but it is not supported "
+                       "on this build (recvmmsg support is required)\n");
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             av_strlcpy(include_sources, buf, sizeof(include_sources));
             rtp_parse_addr_list(h, buf, &s->ssm_include_addrs, &s->nb_ssm_include_addrs);
@@ -332,7 +373,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     for (i = 0;i < max_retry_count;i++) {
         build_udp_url(buf, sizeof(buf),
                       hostname, rtp_port, local_rtp_port, ttl, max_packet_size,
-                      connect, include_sources, exclude_sources);
+                      connect, send_batch, include_sources, exclude_sources);
         if (ffurl_open(&s->rtp_hd, buf, flags, &h->interrupt_callback, NULL) < 0)
             goto fail;
         local_rtp_port = ff_udp_get_local_port(s->rtp_hd);
@@ -344,7 +385,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
             local_rtcp_port = local_rtp_port + 1;
             build_udp_url(buf, sizeof(buf),
                           hostname, rtcp_port, local_rtcp_port, ttl, max_packet_size,
-                          connect, include_sources, exclude_sources);
+                          connect, 0, include_sources, exclude_sources);
             if (ffurl_open(&s->rtcp_hd, buf, flags, &h->interrupt_callback, NULL) < 0) {
                 local_rtp_port = local_rtcp_port = -1;
                 continue;
@@ -353,7 +394,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
         build_udp_url(buf, sizeof(buf),
                       hostname, rtcp_port, local_rtcp_port, ttl, max_packet_size,
-                      connect, include_sources, exclude_sources);
+                      connect, 0, include_sources, exclude_sources);
         if (ffurl_open(&s->rtcp_hd, buf, flags, &h->interrupt_callback, NULL) < 0)
             goto fail;
         break;
@@ -366,9 +407,32 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
 
     h->max_packet_size = s->rtp_hd->max_packet_size;
     h->is_streamed = 1;
+
+#if HAVE_RECVMMSG
+    if (s->recv_batch > 1 && (flags & AVIO_FLAG_READ)) {
+        /* datagrams up to the maximum UDP size, unless pkt_size was given */
+        int slot_size = max_packet_size > 0 ? FFMIN(max_packet_size, RTP_MAX_PKT_SIZE)
+                                            : RTP_MAX_PKT_SIZE;
+        s->batch_slot_size = slot_size;
+        s->msgs      = av_mallocz_array(s->recv_batch, sizeof(*s->msgs));
+        s->iov       = av_mallocz_array(s->recv_batch, sizeof(*s->iov));
+        s->addrs     = av_mallocz_array(s->recv_batch, sizeof(*s->addrs));
+        s->batch_buf = av_malloc_array(s->recv_batch, slot_size);
+        if (!s->msgs || !s->iov || !s->addrs || !s->batch_buf)
+            goto fail;
+        for (i = 0; i < s->recv_batch; i++) {
+            s->iov[i].iov_base = s->batch_buf + i * slot_size;
+            s->iov[i].iov_len  = slot_size;
+            s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+            s->msgs[i].msg_hdr.msg_iovlen = 1;
+            s->msgs[i].msg_hdr.msg_name   = &s->addrs[i];
+        }
+    }
+#endif
     return 0;
 
  fail:
+    rtp_free_batch(s);
     if (s->rtp_hd)
         ffurl_close(s->rtp_hd);
     if (s->rtcp_hd)
@@ -376,6 +440,55 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     return AVERROR(EIO);
 }
 
+#if HAVE_RECVMMSG
+/**
+ * Return the next RTP datagram of the last recvmmsg() batch, skipping the
+ * ones that are truncated or come from a filtered source.
+ * @return the datagram size, or 0 if the batch is exhausted
+ */
+static int rtp_read_batched(URLContext *h, uint8_t *buf, int size)
+{
+    RTPContext *s = h->priv_data;
+
+    while (s->batch_next < s->nb_batched) {
+        struct mmsghdr *msg = &s->msgs[s->batch_next];
+        int len = FFMIN(msg->msg_len, size);
+
+        s->batch_next++;
+        if (msg->msg_hdr.msg_flags & MSG_TRUNC) {
+            av_log(h, AV_LOG_WARNING, "Dropping a datagram larger than %d "
+                   "bytes, increase the pkt_size option\n", s->batch_slot_size);
+            continue;
+        }
+        if (rtp_check_source_lists(s, msg->msg_hdr.msg_name))
+            continue;
+        memcpy(&s->last_rtp_source, msg->msg_hdr.msg_name, msg->msg_hdr.msg_namelen);
+        s->last_rtp_source_len = msg->msg_hdr.msg_namelen;
+        memcpy(buf, msg->msg_hdr.msg_iov->iov_base, len);
+        return len;
+    }
+    return 0;
+}
+
+/**
+ * Receive as many RTP datagrams as available, up to recv_batch, with a
+ * single system call.
+ */
+static int rtp_recv_batch(RTPContext *s)
+{
+    int i, ret;
+
+    for (i = 0; i < s->recv_batch; i++)
+        s->msgs[i].msg_hdr.msg_namelen = sizeof(s->addrs[i]);
+    ret = recvmmsg(s->rtp_fd, s->msgs, s->recv_batch, MSG_DONTWAIT, NULL);
+    if (ret < 0)
+        return ff_neterrno();
+    s->nb_batched = ret;
+    s->batch_next = 0;
+    return ret;
+}
+#endif
+
 static int rtp_read(URLContext *h, uint8_t *buf, int size)
 {
     RTPContext *s = h->priv_data;
@@ -385,6 +498,11 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
     struct sockaddr_storage *addrs[2] = { &s->last_rtp_source, &s->last_rtcp_source };
     socklen_t *addr_lens[2] = { &s->last_rtp_source_len, &s->last_rtcp_source_len };
 
+#if HAVE_RECVMMSG
+    if (s->msgs && (len = rtp_read_batched(h, buf, size)) > 0)
+        return len;
+#endif
+
     for(;;) {
         if (ff_check_interrupt(&h->interrupt_callback))
             return AVERROR_EXIT;
@@ -394,6 +512,19 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
             for (i = 1; i >= 0; i--) {
                 if (!(p[i].revents & POLLIN))
                     continue;
+#if HAVE_RECVMMSG
+                if (i == 0 && s->msgs) {
+                    len = rtp_recv_batch(s);
+                    if (len < 0) {
+                        if (len == AVERROR(EAGAIN) || len == AVERROR(EINTR))
+                            continue;
+                        return AVERROR(EIO);
+                    }
+                    if ((len = rtp_read_batched(h, buf, size)) > 0)
+                        return len;
+                    continue;
+                }
+#endif
                 *addr_lens[i] = sizeof(*addrs[i]);
                 len = recvfrom(p[i].fd, buf, size, 0,
                                 (struct sockaddr *)addrs[i], addr_lens[i]);
@@ -502,11 +633,22 @@ static int rtp_close(URLContext *h)
         av_free(s->ssm_exclude_addrs[i]);
     av_freep(&s->ssm_exclude_addrs);
 
+    rtp_free_batch(s);
     ffurl_close(s->rtp_hd);
     ffurl_close(s->rtcp_hd);
     return 0;
 }
 
+/**
+ * Send the RTP packets queued on the underlying udp handle, if it was
+ * opened with the send_batch option.
+ */
+int ff_rtp_flush(URLContext *h)
+{
+    RTPContext *s = h->priv_data;
+    return ff_udp_flush(s->rtp_hd);
+}
+
 /**
  * Return the local rtp port used by the RTP connection
  * @param h media file context
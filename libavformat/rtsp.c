@@ -74,7 +74,10 @@
     { "data", "Data", 0, AV_OPT_TYPE_CONST, {.i64 = 1 << AVMEDIA_TYPE_DATA}, 0, 0, DEC, "allowed_media_types" }
 
 #define RTSP_REORDERING_OPTS() \
-    { "reorder_queue_size", "set number of packets to buffer for handling of reordered packets", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }
+    { "reorder_queue_size", "set number of packets to buffer for handling of reordered packets", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }, \
+    { "late_packets", "number of RTP packets dropped because they arrived too late", OFFSET(late_packets), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, DEC|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY }, \
+    { "lost_packets", "number of RTP packets skipped when the reordering queue was full", OFFSET(lost_packets), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, DEC|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY }, \
+    { "reordered_packets", "number of RTP packets received out of order", OFFSET(reordered_packets), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, DEC|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY }
 
 const AVOption ff_rtsp_options[] = {
     { "initial_pause",  "do not start playing the stream immediately", OFFSET(initial_pause), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
@@ -92,6 +95,7 @@ const AVOption ff_rtsp_options[] = {
     { "max_port", "set maximum local UDP port", OFFSET(rtp_port_max), AV_OPT_TYPE_INT, {.i64 = RTSP_RTP_PORT_MAX}, 0, 65535, DEC|ENC },
     { "timeout", "set maximum timeout (in seconds) to wait for incoming connections (-1 is infinite, imply flag listen)", OFFSET(initial_timeout), AV_OPT_TYPE_INT, {.i64 = -1}, INT_MIN, INT_MAX, DEC },
     { "stimeout", "set timeout (in microseconds) of socket TCP I/O operations", OFFSET(stimeout), AV_OPT_TYPE_INT, {.i64 = 0}, INT_MIN, INT_MAX, DEC },
+    { "recv_batch", "set the maximum number of RTP datagrams received per system call", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, 256, DEC },
     RTSP_REORDERING_OPTS(),
     { "user-agent", "override User-Agent header", OFFSET(user_agent), AV_OPT_TYPE_STRING, {.str = LIBAVFORMAT_IDENT}, 0, 0, DEC },
     { NULL },
@@ -102,6 +106,7 @@ static const AVOption sdp_options[] = {
     { "custom_io", "use custom I/O", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_CUSTOM_IO}, 0, 0, DEC, "rtsp_flags" },
     { "rtcp_to_source", "send RTCP packets to the source address of received packets", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_RTCP_TO_SOURCE}, 0, 0, DEC, "rtsp_flags" },
     RTSP_MEDIATYPE_OPTS("allowed_media_types", "set media types to accept from the server"),
+    { "recv_batch", "set the maximum number of RTP datagrams received per system call", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, 256, DEC },
     RTSP_REORDERING_OPTS(),
     { NULL },
 };
@@ -1403,6 +1408,9 @@ int ff_rtsp_make_setup_request(AVFormatContext *s, const char *host, int port,
             while (j <= rt->rtp_port_max) {
                 ff_url_join(buf, sizeof(buf), "rtp", NULL, host, -1,
                             "?localport=%d", j);
+                if (rt->recv_batch > 1)
+                    av_strlcatf(buf, sizeof(buf), "&recv_batch=%d",
+                                rt->recv_batch);
                 /* we will use two ports per rtp stream (rtp and rtcp) */
                 j += 2;
                 if (!ffurl_open(&rtsp_st->rtp_handle, buf, AVIO_FLAG_READ_WRITE,
@@ -1551,6 +1559,9 @@ int ff_rtsp_make_setup_request(AVFormatContext *s, const char *host, int port,
                         namebuf, sizeof(namebuf), NULL, 0, NI_NUMERICHOST);
             ff_url_join(url, sizeof(url), "rtp", NULL, namebuf,
                         port, "%s", optbuf);
+            if (rt->recv_batch > 1)
+                av_strlcatf(url, sizeof(url), "%crecv_batch=%d",
+                            ttl > 0 ? '&' : '?', rt->recv_batch);
             if (ffurl_open(&rtsp_st->rtp_handle, url, AVIO_FLAG_READ_WRITE,
                            &s->interrupt_callback, NULL) < 0) {
                 err = AVERROR_INVALIDDATA;
@@ -1960,6 +1971,25 @@ static int pick_stream(AVFormatContext *s, RTSPStream **rtsp_st,
     return AVERROR(EAGAIN);
 }
 
+/**
+ * Sum up the reordering statistics of all RTP streams, to make them
+ * available through the exported AVOptions.
+ */
+static void update_reordering_stats(RTSPState *rt)
+{
+    int i;
+
+    rt->late_packets = rt->lost_packets = rt->reordered_packets = 0;
+    for (i = 0; i < rt->nb_rtsp_streams; i++) {
+        RTPDemuxContext *rtpctx = rt->rtsp_streams[i]->transport_priv;
+        if (!rtpctx)
+            continue;
+        rt->late_packets      += rtpctx->late_packets;
+        rt->lost_packets      += rtpctx->lost_packets;
+        rt->reordered_packets += rtpctx->reordered_packets;
+    }
+}
+
 int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 {
     RTSPState *rt = s->priv_data;
@@ -2131,6 +2161,8 @@ redo:
         return AVERROR_INVALIDDATA;
     }
 end:
+    if (rt->transport == RTSP_TRANSPORT_RTP)
+        update_reordering_stats(rt);
     if (ret < 0)
         goto redo;
     if (ret == 1)
@@ -2223,6 +2255,8 @@ static int sdp_read_header(AVFormatContext *s)
             append_source_addrs(url, sizeof(url), "block",
                                 rtsp_st->nb_exclude_source_addrs,
                                 rtsp_st->exclude_source_addrs);
+            if (rt->recv_batch > 1)
+                av_strlcatf(url, sizeof(url), "&recv_batch=%d", rt->recv_batch);
             if (ffurl_open(&rtsp_st->rtp_handle, url, AVIO_FLAG_READ_WRITE,
                            &s->interrupt_callback, NULL) < 0) {
                 err = AVERROR_INVALIDDATA;
@@ -400,6 +400,19 @@ typedef struct RTSPState {
      */
     int reordering_queue_size;
 
+    /**
+     * Maximum number of RTP datagrams received per system call.
+     */
+    int recv_batch;
+
+    /**
+     * RTP reordering statistics, summed over all streams and exported
+     * as read-only options.
+     */
+    int64_t late_packets;
+    int64_t lost_packets;
+    int64_t reordered_packets;
+
     /**
      * User-Agent string
      */
@@ -26,11 +26,19 @@
 
 /* #define DEBUG */
 
+#include "config.h"
 #include <float.h>
 #include <time.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "avformat.h"
 #include "internal.h"
+#include "os_support.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/log.h"
@@ -62,6 +70,7 @@ typedef enum {
 
 #define SEGMENT_LIST_FLAG_CACHE 1
 #define SEGMENT_LIST_FLAG_LIVE  2
+#define SEGMENT_LIST_FLAG_DURATION 4
 
 typedef struct {
     const AVClass *class;  /**< Class for private options. */
@@ -110,6 +119,18 @@ typedef struct {
     SegmentListEntry *segment_list_entries_end;
 
     int is_first_pkt;      ///< tells if it is the first packet in the segment
+
+    int preopen;           ///< open the next segment file ahead of the split point
+    AVIOContext *close_pb; ///< context of the finished segment, closed in the background
+    AVIOContext *next_pb;  ///< context of the next segment, opened in the background
+    char next_filename[1024]; ///< filename of next_pb
+#if HAVE_PTHREADS
+    pthread_t io_thread;   ///< thread closing close_pb and opening next_pb
+    int io_thread_active;
+#endif
+
+    int64_t stall_max;     ///< longest time spent switching segments, in microseconds
+    int64_t stall_total;   ///< total time spent switching segments, in microseconds
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -193,6 +214,90 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
+static void *segment_io_task(void *arg)
+{
+    AVFormatContext *s  = arg;
+    SegmentContext *seg = s->priv_data;
+
+    avio_close(seg->close_pb);
+    seg->close_pb = NULL;
+
+    /* a file already present, e.g. when restarting into an existing
+     * archive, is left alone until the split point is actually reached */
+    if (seg->next_filename[0]) {
+        const char *proto = avio_find_protocol_name(seg->next_filename);
+        if (proto && !strcmp(proto, "file") &&
+            avio_check(seg->next_filename, 0) >= 0)
+            seg->next_filename[0] = 0;
+    }
+    if (seg->next_filename[0] &&
+        avio_open2(&seg->next_pb, seg->next_filename, AVIO_FLAG_WRITE,
+                   &s->interrupt_callback, NULL) < 0)
+        seg->next_pb = NULL;
+    return NULL;
+}
+
+/**
+ * Close the finished segment and open the one following the current
+ * segment, in a background thread if available.
+ */
+static void segment_io_start(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+
+    /* when wrapping, the next file is a previous segment which must be kept
+     * until the split point is actually reached */
+    if (seg->segment_idx_wrap ||
+        av_get_frame_filename(seg->next_filename, sizeof(seg->next_filename),
+                              s->filename, seg->segment_idx + 1) < 0)
+        seg->next_filename[0] = 0;
+
+#if HAVE_PTHREADS
+    if (!pthread_create(&seg->io_thread, NULL, segment_io_task, s)) {
+        seg->io_thread_active = 1;
+        return;
+    }
+    av_log(s, AV_LOG_WARNING, "Could not create the segment I/O thread\n");
+#endif
+    segment_io_task(s);
+}
+
+static void segment_io_wait(AVFormatContext *s)
+{
+#if HAVE_PTHREADS
+    SegmentContext *seg = s->priv_data;
+
+    if (seg->io_thread_active) {
+        pthread_join(seg->io_thread, NULL);
+        seg->io_thread_active = 0;
+    }
+#endif
+}
+
+/**
+ * Close and remove the segment opened in advance, if it was not used.
+ */
+static void segment_io_discard(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    const char *proto, *path;
+
+    segment_io_wait(s);
+    avio_close(seg->close_pb);
+    seg->close_pb = NULL;
+    if (!seg->next_pb)
+        return;
+    avio_close(seg->next_pb);
+    seg->next_pb = NULL;
+
+    proto = avio_find_protocol_name(seg->next_filename);
+    if (proto && !strcmp(proto, "file")) {
+        path = seg->next_filename;
+        av_strstart(path, "file:", &path);
+        unlink(path);
+    }
+}
+
 static int segment_start(AVFormatContext *s, int write_header)
 {
     SegmentContext *seg = s->priv_data;
@@ -214,11 +319,16 @@ static int segment_start(AVFormatContext *s, int write_header)
     if ((err = set_segment_filename(s)) < 0)
         return err;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0) {
+    if (seg->next_pb && !strcmp(seg->next_filename, oc->filename)) {
+        oc->pb = seg->next_pb;
+        seg->next_pb = NULL;
+    } else if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
+                                 &s->interrupt_callback, NULL)) < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
         return err;
     }
+    if (seg->preopen)
+        segment_io_start(s);
 
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "resend_headers", "1", 0); /* mpegts specific */
@@ -269,6 +379,7 @@ static int segment_list_open(AVFormatContext *s)
 
 static void segment_list_print_entry(AVIOContext      *list_ioctx,
                                      ListType          list_type,
+                                     int               list_flags,
                                      const SegmentListEntry *list_entry,
                                      void *log_ctx)
 {
@@ -294,6 +405,9 @@ static void segment_list_print_entry(AVIOContext      *list_ioctx,
             return;
         }
         avio_printf(list_ioctx, "file %s\n", buf);
+        if (list_flags & SEGMENT_LIST_FLAG_DURATION)
+            avio_printf(list_ioctx, "duration %f\n",
+                        list_entry->end_time - list_entry->start_time);
         av_free(buf);
         break;
     }
@@ -308,6 +422,8 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     AVFormatContext *oc = seg->avf;
     int ret = 0;
 
+    segment_io_wait(s);
+
     av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
     if (write_trailer)
         ret = av_write_trailer(oc);
@@ -344,11 +460,11 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
             if ((ret = segment_list_open(s)) < 0)
                 goto end;
             for (entry = seg->segment_list_entries; entry; entry = entry->next)
-                segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
+                segment_list_print_entry(seg->list_pb, seg->list_type, seg->list_flags, entry, s);
             if (seg->list_type == LIST_TYPE_M3U8 && is_last)
                 avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
         } else {
-            segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
+            segment_list_print_entry(seg->list_pb, seg->list_type, seg->list_flags, &seg->cur_entry, s);
         }
         avio_flush(seg->list_pb);
     }
@@ -358,7 +474,11 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     seg->segment_count++;
 
 end:
-    avio_close(oc->pb);
+    if (seg->preopen && !is_last)
+        seg->close_pb = oc->pb;
+    else
+        avio_close(oc->pb);
+    oc->pb = NULL;
 
     return ret;
 }
@@ -667,6 +787,9 @@ static int seg_write_header(AVFormatContext *s)
             goto fail;
     }
 
+    if (seg->preopen)
+        segment_io_start(s);
+
 fail:
     if (ret) {
         if (seg->list)
@@ -726,12 +849,20 @@ static int seg_write_packet(AVFormatContext *s, AVPacket *pkt)
          (pkt->pts != AV_NOPTS_VALUE &&
           av_compare_ts(pkt->pts, st->time_base,
                         end_pts-seg->time_delta, AV_TIME_BASE_Q) >= 0))) {
+        int64_t stall = av_gettime_relative();
+
         if ((ret = segment_end(s, seg->individual_header_trailer, 0)) < 0)
             goto fail;
 
         if ((ret = segment_start(s, seg->individual_header_trailer)) < 0)
             goto fail;
 
+        stall = av_gettime_relative() - stall;
+        seg->stall_max    = FFMAX(seg->stall_max, stall);
+        seg->stall_total += stall;
+        av_log(s, AV_LOG_VERBOSE, "segment:'%s' switch took %"PRId64"us\n",
+               seg->avf->filename, stall);
+
         seg->cut_pending = 0;
         seg->cur_entry.index = seg->segment_idx + seg->segment_idx_wrap*seg->segment_idx_wrap_nb;
         seg->cur_entry.start_time = (double)pkt->pts * av_q2d(st->time_base);
@@ -792,6 +923,11 @@ static int seg_write_trailer(struct AVFormatContext *s)
         ret = segment_end(s, 1, 1);
     }
 fail:
+    segment_io_discard(s);
+    if (seg->segment_count > 1)
+        av_log(s, AV_LOG_VERBOSE, "segment switch time max:%"PRId64"us avg:%"PRId64"us\n",
+               seg->stall_max, seg->stall_total / (seg->segment_count - 1));
+
     if (seg->list)
         avio_close(seg->list_pb);
 
@@ -821,6 +957,7 @@ static const AVOption options[] = {
     { "segment_list_flags","set flags affecting segment list generation", OFFSET(list_flags), AV_OPT_TYPE_FLAGS, {.i64 = SEGMENT_LIST_FLAG_CACHE }, 0, UINT_MAX, E, "list_flags"},
     { "cache",             "allow list caching",                                    0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_LIST_FLAG_CACHE }, INT_MIN, INT_MAX,   E, "list_flags"},
     { "live",              "enable live-friendly list generation (useful for HLS)", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_LIST_FLAG_LIVE }, INT_MIN, INT_MAX,    E, "list_flags"},
+    { "duration",          "write the duration of each segment in ffconcat lists",  0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_LIST_FLAG_DURATION }, INT_MIN, INT_MAX, E, "list_flags"},
 
     { "segment_list_size", "set the maximum number of playlist entries", OFFSET(list_size), AV_OPT_TYPE_INT,  {.i64 = 0},     0, INT_MAX, E },
 
@@ -846,6 +983,7 @@ static const AVOption options[] = {
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
+    { "segment_preopen", "open the next segment and close the previous one in the background", OFFSET(preopen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -55,6 +56,8 @@
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+#define UDP_MAX_RECV_BATCH 256
+#define UDP_MAX_SEND_BATCH 1024
 
 typedef struct {
     const AVClass *class;
@@ -80,6 +83,21 @@ typedef struct {
     pthread_cond_t cond;
     int thread_started;
 #endif
+#if HAVE_RECVMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    uint8_t *batch_buf;
+    int batch_slot_size;    ///< size of each datagram slot in batch_buf
+    int nb_batched, batch_next; ///< datagrams received and returned by udp_read()
+#endif
+    int recv_batch;
+#if HAVE_SENDMMSG
+    struct mmsghdr *send_msgs;
+    struct iovec *send_iov;
+    uint8_t *send_buf;
+#endif
+    int send_batch;
+    int nb_queued;      ///< number of datagrams waiting in send_msgs
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *local_addr;
@@ -103,6 +121,8 @@ static const AVOption options[] = {
 /* TODO 'sources', 'block' option */
 {"fifo_size", "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
 {"overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
+{"send_batch", "set the maximum number of datagrams to queue and send with a single system call", OFFSET(send_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, UDP_MAX_SEND_BATCH, E },
+{"recv_batch", "set the maximum number of datagrams received per system call", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, UDP_MAX_RECV_BATCH, D },
 {"timeout", "set raise error timeout (only in read mode)", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
 {NULL}
 };
@@ -372,6 +392,44 @@ static int udp_port(struct sockaddr_storage *addr, int addr_len)
 }
 
 
+/**
+ * Send the datagrams queued by udp_write() with as few system calls as
+ * possible. Queued datagrams are dropped in case of error.
+ */
+static int udp_send_queued(URLContext *h)
+{
+#if HAVE_SENDMMSG
+    UDPContext *s = h->priv_data;
+    int i, ret = 0, sent = 0;
+
+    for (i = 0; i < s->nb_queued; i++) {
+        s->send_msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+        s->send_msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0 : s->dest_addr_len;
+    }
+    while (sent < s->nb_queued) {
+        if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+            ret = ff_network_wait_fd(s->udp_fd, 1);
+            if (ret < 0)
+                break;
+        }
+        ret = sendmmsg(s->udp_fd, s->send_msgs + sent, s->nb_queued - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EINTR) ||
+                (ret == AVERROR(EAGAIN) && !(h->flags & AVIO_FLAG_NONBLOCK)))
+                continue;
+            break;
+        }
+        sent += ret;
+        ret   = 0;
+    }
+    s->nb_queued = 0;
+    return ret;
+#else
+    return 0;
+#endif
+}
+
 /**
  * If no filename is given to av_open_input_file because you want to
  * get the local port first, then you must call this function to set
@@ -392,11 +450,15 @@ int ff_udp_set_remote_url(URLContext *h, const char *uri)
 {
     UDPContext *s = h->priv_data;
     char hostname[256], buf[10];
-    int port;
+    int port, ret;
     const char *p;
 
     av_url_split(NULL, 0, NULL, 0, hostname, sizeof(hostname), &port, NULL, 0, uri);
 
+    /* the queued datagrams are meant for the previous destination */
+    if ((ret = udp_send_queued(h)) < 0)
+        return ret;
+
     /* set the destination address */
     s->dest_addr_len = udp_set_url(&s->dest_addr, hostname, port);
     if (s->dest_addr_len < 0) {
@@ -459,13 +521,22 @@ static void *circular_buffer_task( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, i, nb_dgrams = 1;
+        uint8_t *dgram = s->tmp;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        if (s->msgs) {
+            /* Block for the first datagram only, then take whatever else
+             * is already queued on the socket. */
+            len = nb_dgrams = recvmmsg(s->udp_fd, s->msgs, s->recv_batch,
+                                       MSG_WAITFORONE, NULL);
+        } else
+#endif
         len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
@@ -476,23 +547,37 @@ static void *circular_buffer_task( void *_URLContext)
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+        for (i = 0; i < nb_dgrams; i++) {
+#if HAVE_RECVMMSG
+            if (s->msgs) {
+                dgram = s->batch_buf + i * s->batch_slot_size;
+                len   = s->msgs[i].msg_len;
+                if (s->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                    av_log(h, AV_LOG_WARNING, "Dropping a datagram larger "
+                           "than %d bytes, increase the pkt_size option\n",
+                           s->batch_slot_size - 4);
+                    continue;
+                }
+            }
+#endif
+            AV_WL32(dgram, len);
+
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_generic_write(s->fifo, dgram, len+4, NULL);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
     }
 
@@ -503,6 +588,20 @@ end:
 }
 #endif
 
+static void udp_free_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->batch_buf);
+#endif
+#if HAVE_SENDMMSG
+    av_freep(&s->send_msgs);
+    av_freep(&s->send_iov);
+    av_freep(&s->send_buf);
+#endif
+}
+
 static int parse_source_list(char *buf, char **sources, int *num_sources,
                              int max_sources)
 {
@@ -536,7 +635,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     char buf[256];
     struct sockaddr_storage my_addr;
     socklen_t len;
-    int reuse_specified = 0;
+    int reuse_specified = 0, pkt_size_set = 0;
     int i, num_include_sources = 0, num_exclude_sources = 0;
     char *include_sources[32], *exclude_sources[32];
 
@@ -575,6 +674,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
         if (av_find_info_tag(buf, sizeof(buf), "pkt_size", p)) {
             s->packet_size = strtol(buf, NULL, 10);
+            pkt_size_set = 1;
         }
         if (av_find_info_tag(buf, sizeof(buf), "buffer_size", p)) {
             s->buffer_size = strtol(buf, NULL, 10);
@@ -589,6 +689,20 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'circular_buffer_size' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_SEND_BATCH);
+            if (!HAVE_SENDMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'send_batch' option was set but it is not supported "
+                       "on this build (sendmmsg support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_RECV_BATCH);
+            if (!HAVE_RECVMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'recv_batch' option was set but it is not supported "
+                       "on this build (recvmmsg support is required)\n");
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -737,6 +851,42 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+#if HAVE_SENDMMSG
+    if (is_output && s->send_batch > 1) {
+        s->send_msgs = av_mallocz_array(s->send_batch, sizeof(*s->send_msgs));
+        s->send_iov  = av_mallocz_array(s->send_batch, sizeof(*s->send_iov));
+        s->send_buf  = av_malloc_array(s->send_batch, s->packet_size);
+        if (!s->send_msgs || !s->send_iov || !s->send_buf)
+            goto fail;
+        for (i = 0; i < s->send_batch; i++) {
+            s->send_iov[i].iov_base = s->send_buf + i * s->packet_size;
+            s->send_msgs[i].msg_hdr.msg_iov    = &s->send_iov[i];
+            s->send_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+
+#if HAVE_RECVMMSG
+    if (!is_output && s->recv_batch > 1) {
+        /* datagrams up to the maximum UDP size, unless pkt_size was given
+         * in the URL or changed from its default through the options */
+        int slot_size = (pkt_size_set || s->packet_size != 1472) && s->packet_size > 0 ?
+                        FFMIN(s->packet_size, UDP_MAX_PKT_SIZE) : UDP_MAX_PKT_SIZE;
+        s->batch_slot_size = slot_size + 4;
+        s->msgs      = av_mallocz_array(s->recv_batch, sizeof(*s->msgs));
+        s->iov       = av_mallocz_array(s->recv_batch, sizeof(*s->iov));
+        s->batch_buf = av_malloc_array(s->recv_batch, s->batch_slot_size);
+        if (!s->msgs || !s->iov || !s->batch_buf)
+            goto fail;
+        for (i = 0; i < s->recv_batch; i++) {
+            s->iov[i].iov_base = s->batch_buf + i * s->batch_slot_size + 4;
+            s->iov[i].iov_len  = slot_size;
+            s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+            s->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     if (!is_output && s->circular_buffer_size) {
         int ret;
@@ -773,6 +923,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -829,6 +980,35 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     }
 #endif
 
+#if HAVE_RECVMMSG
+    if (s->msgs) {
+        while (1) {
+            while (s->batch_next < s->nb_batched) {
+                struct mmsghdr *msg = &s->msgs[s->batch_next++];
+                if (msg->msg_hdr.msg_flags & MSG_TRUNC) {
+                    av_log(h, AV_LOG_WARNING, "Dropping a datagram larger "
+                           "than %d bytes, increase the pkt_size option\n",
+                           s->batch_slot_size - 4);
+                    continue;
+                }
+                ret = FFMIN(msg->msg_len, size);
+                memcpy(buf, msg->msg_hdr.msg_iov->iov_base, ret);
+                return ret;
+            }
+            if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+                ret = ff_network_wait_fd(s->udp_fd, 0);
+                if (ret < 0)
+                    return ret;
+            }
+            ret = recvmmsg(s->udp_fd, s->msgs, s->recv_batch, MSG_DONTWAIT, NULL);
+            if (ret < 0)
+                return ff_neterrno();
+            s->nb_batched = ret;
+            s->batch_next = 0;
+        }
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -839,11 +1019,32 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+int ff_udp_flush(URLContext *h)
+{
+    return udp_send_queued(h);
+}
+
 static int udp_write(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_SENDMMSG
+    if (s->send_msgs) {
+        if (size <= s->packet_size) {
+            memcpy(s->send_iov[s->nb_queued].iov_base, buf, size);
+            s->send_iov[s->nb_queued].iov_len = size;
+            if (++s->nb_queued == s->send_batch &&
+                (ret = udp_send_queued(h)) < 0)
+                return ret;
+            return size;
+        }
+        /* Too large to be queued, keep the datagrams in order */
+        if ((ret = udp_send_queued(h)) < 0)
+            return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -865,6 +1066,7 @@ static int udp_close(URLContext *h)
     UDPContext *s = h->priv_data;
     int ret;
 
+    udp_send_queued(h);
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr,(struct sockaddr *)&s->local_addr_storage);
     closesocket(s->udp_fd);
@@ -879,6 +1081,7 @@ static int udp_close(URLContext *h)
     }
 #endif
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     return 0;
 }
 
@@ -246,6 +246,14 @@ URLProtocol *ffurl_protocol_next(URLProtocol *prev);
 int ff_udp_set_remote_url(URLContext *h, const char *uri);
 int ff_udp_get_local_port(URLContext *h);
 
+/**
+ * Send the datagrams queued on an udp URLContext opened with the
+ * send_batch option. Should be called at the end of each frame.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_udp_flush(URLContext *h);
+
 /**
  * Assemble a URL string from components. This is the reverse operation
  * of av_url_split.
@@ -378,7 +378,7 @@ int av_probe_input_buffer2(AVIOContext *pb, AVInputFormat **fmt,
 {
     AVProbeData pd = { filename ? filename : "" };
     uint8_t *buf = NULL;
-    uint8_t *mime_type;
+    uint8_t *mime_type, *format_name;
     int ret = 0, probe_size, buf_offset = 0;
     int score = 0;
 
@@ -400,6 +400,15 @@ int av_probe_input_buffer2(AVIOContext *pb, AVInputFormat **fmt,
         av_freep(&mime_type);
     }
 
+    /* protocols which know the format of their data, skip probing */
+    if (!*fmt && pb->av_class && av_opt_get(pb, "format_name", AV_OPT_SEARCH_CHILDREN, &format_name) >= 0 && format_name) {
+        *fmt = av_find_input_format(format_name);
+        if (*fmt)
+            av_log(logctx, AV_LOG_DEBUG, "Format %s set by the protocol\n",
+                   (*fmt)->name);
+        av_freep(&format_name);
+    }
+
     for (probe_size = PROBE_BUF_MIN; probe_size <= max_probe_size && !*fmt;
          probe_size = FFMIN(probe_size << 1,
                             FFMAX(max_probe_size, probe_size + 1))) {
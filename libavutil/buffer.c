@@ -112,8 +112,13 @@ void av_buffer_unref(AVBufferRef **buf)
     av_freep(buf);
 
     if (!avpriv_atomic_int_add_and_fetch(&b->refcount, -1)) {
+        /* b may be part of a pool entry, which can be reused by another
+         * thread as soon as it is released, so check the flag first */
+        int free_avbuffer = !(b->flags & BUFFER_FLAG_NO_FREE);
+
         b->free(b->opaque, b->data);
-        av_freep(&b);
+        if (free_avbuffer)
+            av_free(b);
     }
 }
 
@@ -223,9 +228,9 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    while (pool->entries) {
+        BufferPoolEntry *buf = pool->entries;
+        pool->entries = buf->all_next;
 
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
@@ -282,6 +287,42 @@ static void add_to_pool(BufferPoolEntry *buf)
     }
 }
 
+/* index of the first cache slot tried by the calling thread */
+static unsigned pool_cache_hint(void)
+{
+    int local;
+    uint32_t page = (uintptr_t)&local >> 12;
+
+    return (page * 2654435761U >> 24) % POOL_CACHE_SIZE;
+}
+
+/* take an entry from nb cache slots, starting at slot hint */
+static BufferPoolEntry *get_from_cache(AVBufferPool *pool, unsigned hint, int nb)
+{
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        void * volatile *slot = (void * volatile *)&pool->cache[(hint + i) % POOL_CACHE_SIZE];
+        BufferPoolEntry *buf = *slot;
+        if (buf && avpriv_atomic_ptr_cas(slot, buf, NULL) == buf)
+            return buf;
+    }
+    return NULL;
+}
+
+static int add_to_cache(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    unsigned hint = pool_cache_hint();
+    int i;
+
+    for (i = 0; i < POOL_CACHE_PROBE; i++) {
+        void * volatile *slot = (void * volatile *)&pool->cache[(hint + i) % POOL_CACHE_SIZE];
+        if (!*slot && !avpriv_atomic_ptr_cas(slot, NULL, buf))
+            return 1;
+    }
+    return 0;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -290,11 +331,20 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    add_to_pool(buf);
+    if (!add_to_cache(pool, buf))
+        add_to_pool(buf);
     if (!avpriv_atomic_int_add_and_fetch(&pool->refcount, -1))
         buffer_pool_free(pool);
 }
 
+/* refcount is the pool reference plus the buffers in use; the update is
+ * not atomic, concurrent calls may miss a new peak */
+static void update_peak(AVBufferPool *pool, int refcount)
+{
+    if (refcount - 1 > pool->peak_in_use)
+        pool->peak_in_use = refcount - 1;
+}
+
 /* allocate a new buffer and override its free() callback so that
  * it is returned to the pool on free */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
@@ -320,39 +370,197 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     ret->buffer->opaque = buf;
     ret->buffer->free   = pool_release_buffer;
 
-    avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    do {
+        buf->all_next = pool->entries;
+    } while (avpriv_atomic_ptr_cas((void * volatile *)&pool->entries,
+                                   buf->all_next, buf) != buf->all_next);
+
+    update_peak(pool, avpriv_atomic_int_add_and_fetch(&pool->refcount, 1));
     avpriv_atomic_int_add_and_fetch(&pool->nb_allocated, 1);
 
     return ret;
 }
 
+/* get an unused entry: from the slots of this thread first, then from
+ * the shared list, and finally from the slots of other threads */
+static BufferPoolEntry *get_entry(AVBufferPool *pool, unsigned hint)
+{
+    BufferPoolEntry *buf = get_from_cache(pool, hint, POOL_CACHE_PROBE);
+
+    if (buf)
+        return buf;
+
+    buf = get_pool(pool);
+    if (buf) {
+        /* keep the first entry, return the rest of the list to the pool */
+        add_to_pool(buf->next);
+        buf->next = NULL;
+        return buf;
+    }
+
+    return get_from_cache(pool, hint + POOL_CACHE_PROBE,
+                          POOL_CACHE_SIZE - POOL_CACHE_PROBE);
+}
+
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
     AVBufferRef *ret;
     BufferPoolEntry *buf;
+    unsigned hint = pool_cache_hint();
 
     /* check whether the pool is empty */
-    buf = get_pool(pool);
+    buf = get_entry(pool, hint);
     if (!buf && pool->refcount <= pool->nb_allocated) {
         av_log(NULL, AV_LOG_DEBUG, "Pool race dectected, spining to avoid overallocation and eventual OOM\n");
         while (!buf && avpriv_atomic_int_get(&pool->refcount) <= avpriv_atomic_int_get(&pool->nb_allocated))
-            buf = get_pool(pool);
+            buf = get_entry(pool, hint);
     }
 
     if (!buf)
         return pool_alloc_buffer(pool);
 
-    /* keep the first entry, return the rest of the list to the pool */
-    add_to_pool(buf->next);
-    buf->next = NULL;
-
-    ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                           buf, 0);
+    ret = av_mallocz(sizeof(*ret));
     if (!ret) {
         add_to_pool(buf);
         return NULL;
     }
-    avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    buf->buffer.data     = buf->data;
+    buf->buffer.size     = pool->size;
+    buf->buffer.free     = pool_release_buffer;
+    buf->buffer.opaque   = buf;
+    buf->buffer.refcount = 1;
+    buf->buffer.flags    = BUFFER_FLAG_NO_FREE;
+
+    ret->buffer = &buf->buffer;
+    ret->data   = buf->data;
+    ret->size   = pool->size;
+
+    buf->nb_reused++;
+    update_peak(pool, avpriv_atomic_int_add_and_fetch(&pool->refcount, 1));
 
     return ret;
 }
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, int64_t *hits,
+                              int64_t *misses, int *in_use, int *peak_in_use)
+{
+    BufferPoolEntry *buf;
+    int64_t reused = 0;
+
+    for (buf = pool->entries; buf; buf = buf->all_next)
+        reused += buf->nb_reused;
+
+    if (hits)
+        *hits = reused;
+    if (misses)
+        *misses = avpriv_atomic_int_get(&pool->nb_allocated);
+    if (in_use)
+        *in_use = avpriv_atomic_int_get(&pool->refcount) - 1;
+    if (peak_in_use)
+        *peak_in_use = pool->peak_in_use;
+}
+
+#ifdef TEST
+#include <stdio.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "time.h"
+
+#define NB_THREADS 4
+#define NB_HELD    8
+
+static int nb_iterations = 20000;
+
+static void print_stats(AVBufferPool *pool)
+{
+    int64_t hits, misses;
+    int in_use, peak;
+
+    av_buffer_pool_get_stats(pool, &hits, &misses, &in_use, &peak);
+    printf("hits %"PRId64" misses %"PRId64" in use %d peak %d\n",
+           hits, misses, in_use, peak);
+}
+
+/* keep NB_HELD buffers, replacing the oldest one at each iteration */
+static void *stress_thread(void *arg)
+{
+    AVBufferPool *pool = arg;
+    AVBufferRef *held[NB_HELD] = { NULL };
+    intptr_t failed = 0;
+    int i;
+
+    for (i = 0; i < nb_iterations; i++) {
+        AVBufferRef **ref = &held[i % NB_HELD];
+        av_buffer_unref(ref);
+        *ref = av_buffer_pool_get(pool);
+        if (!*ref) {
+            failed = 1;
+            break;
+        }
+        memset((*ref)->data, i, 16);
+    }
+    for (i = 0; i < NB_HELD; i++)
+        av_buffer_unref(&held[i]);
+    return (void *)failed;
+}
+
+int main(int argc, char **argv)
+{
+    AVBufferPool *pool = av_buffer_pool_init(1024, NULL);
+    AVBufferRef *ref[4];
+    int64_t misses, t;
+    int i, in_use, failed = 0;
+
+    printf("Testing av_buffer_pool_get()\n");
+    for (i = 0; i < 4; i++)
+        ref[i] = av_buffer_pool_get(pool);
+    print_stats(pool);
+    av_buffer_unref(&ref[1]);
+    av_buffer_unref(&ref[2]);
+    ref[1] = av_buffer_pool_get(pool);
+    print_stats(pool);
+    ref[2] = av_buffer_pool_get(pool);
+    av_buffer_unref(&ref[0]);
+    av_buffer_unref(&ref[3]);
+    print_stats(pool);
+    for (i = 0; i < 4; i++)
+        av_buffer_unref(&ref[i]);
+    print_stats(pool);
+    av_buffer_pool_uninit(&pool);
+
+    /* Stress test, run long as a benchmark if an argument is given */
+    if (argc > 1)
+        nb_iterations = 1000000;
+    pool = av_buffer_pool_init(1024, NULL);
+    t = av_gettime_relative();
+#if HAVE_PTHREADS
+    {
+        pthread_t threads[NB_THREADS];
+        void *ret;
+        for (i = 0; i < NB_THREADS; i++)
+            if (pthread_create(&threads[i], NULL, stress_thread, pool))
+                return 1;
+        for (i = 0; i < NB_THREADS; i++) {
+            pthread_join(threads[i], &ret);
+            failed |= !!ret;
+        }
+    }
+#else
+    for (i = 0; i < NB_THREADS; i++)
+        failed |= !!stress_thread(pool);
+#endif
+    t = av_gettime_relative() - t;
+    av_buffer_pool_get_stats(pool, NULL, &misses, &in_use, NULL);
+    printf("Stress test: %s, %d in use, %s allocated\n",
+           failed ? "failed" : "ok", in_use,
+           misses <= NB_THREADS * NB_HELD ? "not over" : "over");
+    if (argc > 1)
+        fprintf(stderr, "%d threads: %.1f ns per av_buffer_pool_get()\n",
+                NB_THREADS, t * 1000.0 / nb_iterations / NB_THREADS);
+    av_buffer_pool_uninit(&pool);
+
+    return failed;
+}
+#endif
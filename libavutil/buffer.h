@@ -267,6 +267,24 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Get usage statistics of a buffer pool. Must not be called after
+ * av_buffer_pool_uninit().
+ *
+ * @param hits        if not NULL, set to the number of buffers returned by
+ *                    av_buffer_pool_get() which were reused from the pool
+ * @param misses      if not NULL, set to the number of buffers which had to
+ *                    be allocated
+ * @param in_use      if not NULL, set to the number of buffers currently in
+ *                    use
+ * @param peak_in_use if not NULL, set to the highest number of buffers in use
+ *                    at the same time
+ * @note When the pool is used from several threads, the values are only a
+ *       snapshot and peak_in_use may be slightly underestimated.
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, int64_t *hits,
+                              int64_t *misses, int *in_use, int *peak_in_use);
+
 /**
  * @}
  */
@@ -31,6 +31,11 @@
  * The buffer was av_realloc()ed, so it is reallocatable.
  */
 #define BUFFER_FLAG_REALLOCATABLE (1 << 1)
+/**
+ * The AVBuffer structure is part of a BufferPoolEntry and must not be freed
+ * when the last reference goes away.
+ */
+#define BUFFER_FLAG_NO_FREE       (1 << 2)
 
 struct AVBuffer {
     uint8_t *data; /**< data described by this buffer */
@@ -69,8 +74,35 @@ typedef struct BufferPoolEntry {
 
     AVBufferPool *pool;
     struct BufferPoolEntry * volatile next;
+
+    /*
+     * The AVBuffer handed out by av_buffer_pool_get() for reused entries,
+     * which saves allocating one for each of them.
+     */
+    AVBuffer buffer;
+
+    /*
+     * All the entries of a pool, linked through this field, whether they
+     * are in use or not. Only used for statistics and to free the pool.
+     */
+    struct BufferPoolEntry *all_next;
+
+    /*
+     * Number of times this entry was handed out again by
+     * av_buffer_pool_get(). Only modified by the thread holding the buffer.
+     */
+    int64_t nb_reused;
 } BufferPoolEntry;
 
+/**
+ * Number of single-entry slots kept in front of the shared buffer list.
+ */
+#define POOL_CACHE_SIZE  16
+/**
+ * Number of slots tried, starting at the one hinted by the calling thread.
+ */
+#define POOL_CACHE_PROBE 4
+
 struct AVBufferPool {
     BufferPoolEntry * volatile pool;
 
@@ -87,6 +119,19 @@ struct AVBufferPool {
 
     volatile int nb_allocated;
 
+    /*
+     * Slots holding single returned entries. Threads start looking at a
+     * slot derived from their stack address, so that a thread mostly gets
+     * back the buffers it released itself without touching the shared
+     * list, which has to be swapped out as a whole and walked.
+     */
+    BufferPoolEntry * volatile cache[POOL_CACHE_SIZE];
+
+    BufferPoolEntry * volatile entries;
+
+    /* highest number of buffers in use at the same time, approximate */
+    int peak_in_use;
+
     int size;
     AVBufferRef* (*alloc)(int size);
 };
@@ -18,6 +18,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <limits.h>
 #include <string.h>
 
 #include "avstring.h"
@@ -25,11 +26,97 @@
 #include "internal.h"
 #include "mem.h"
 
+/**
+ * Dictionaries with at least this many entries get a hash index, so that
+ * looking up a key does not need to compare it to every entry.
+ */
+#define DICT_HASH_THRESHOLD 16
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    /**
+     * Open addressing hash index of elems, keyed by the case-folded key.
+     * Slots hold an index into elems plus one, 0 for an empty slot or -1
+     * for a deleted one. NULL if the dictionary is not indexed.
+     */
+    int *hash;
+    unsigned hash_size;     ///< number of slots, a power of 2
+    unsigned hash_used;     ///< number of non-empty slots, deleted ones included
 };
 
+static unsigned dict_hash_key(const char *key)
+{
+    unsigned h = 2166136261U;
+
+    while (*key)
+        h = (h ^ av_toupper(*key++)) * 16777619U;
+    return h;
+}
+
+static int *dict_hash_find_index(AVDictionary *m, int idx)
+{
+    unsigned mask = m->hash_size - 1;
+    unsigned i    = dict_hash_key(m->elems[idx].key) & mask;
+
+    while (m->hash[i] != idx + 1)
+        i = (i + 1) & mask;
+    return &m->hash[i];
+}
+
+static void dict_hash_insert(AVDictionary *m, int idx)
+{
+    unsigned mask = m->hash_size - 1;
+    unsigned i    = dict_hash_key(m->elems[idx].key) & mask;
+
+    while (m->hash[i] > 0)
+        i = (i + 1) & mask;
+    if (!m->hash[i])
+        m->hash_used++;
+    m->hash[i] = idx + 1;
+}
+
+/**
+ * (Re)build the hash index, sized for the current number of entries.
+ * The dictionary is left unindexed if the allocation fails.
+ */
+static void dict_hash_rebuild(AVDictionary *m)
+{
+    unsigned size = 64;
+    int i;
+
+    while (size < 4U * m->count)
+        size <<= 1;
+    av_freep(&m->hash);
+    m->hash_size = m->hash_used = 0;
+    m->hash = av_mallocz_array(size, sizeof(*m->hash));
+    if (!m->hash)
+        return;
+    m->hash_size = size;
+    for (i = 0; i < m->count; i++)
+        dict_hash_insert(m, i);
+}
+
+static AVDictionaryEntry *dict_hash_get(AVDictionary *m, const char *key,
+                                        int flags)
+{
+    unsigned mask = m->hash_size - 1;
+    unsigned i    = dict_hash_key(key) & mask;
+    int found     = INT_MAX;
+
+    /* Keys differing only in case share the chain, return the first
+     * matching one in insertion order as the linear search would. */
+    for (; m->hash[i]; i = (i + 1) & mask) {
+        int idx = m->hash[i] - 1;
+        if (idx < 0 || idx >= found)
+            continue;
+        if (flags & AV_DICT_MATCH_CASE ? !strcmp(m->elems[idx].key, key)
+                                       : !av_strcasecmp(m->elems[idx].key, key))
+            found = idx;
+    }
+    return found < INT_MAX ? &m->elems[found] : NULL;
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -43,6 +130,9 @@ AVDictionaryEntry *av_dict_get(FF_CONST_AVUTIL53 AVDictionary *m, const char *ke
     if (!m)
         return NULL;
 
+    if (m->hash && !prev && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return dict_hash_get(m, key, flags);
+
     if (prev)
         i = prev - m->elems + 1;
     else
@@ -85,6 +175,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             oldval = tag->value;
         else
             av_free(tag->value);
+        if (m->hash) {
+            int idx = tag - m->elems;
+            *dict_hash_find_index(m, idx) = -1;
+            if (idx != m->count - 1)
+                *dict_hash_find_index(m, m->count - 1) = idx + 1;
+        }
         av_free(tag->key);
         *tag = m->elems[--m->count];
     } else {
@@ -114,9 +210,14 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         } else
             m->elems[m->count].value = av_strdup(value);
         m->count++;
+        if (m->hash && 2 * m->hash_used < m->hash_size)
+            dict_hash_insert(m, m->count - 1);
+        else if (m->hash || m->count >= DICT_HASH_THRESHOLD)
+            dict_hash_rebuild(m);
     }
     if (!m->count) {
         av_free(m->elems);
+        av_free(m->hash);
         av_freep(pm);
     }
 
@@ -180,6 +281,7 @@ void av_dict_free(AVDictionary **pm)
             av_free(m->elems[m->count].value);
         }
         av_free(m->elems);
+        av_free(m->hash);
     }
     av_freep(pm);
 }
@@ -191,3 +293,89 @@ void av_dict_copy(AVDictionary **dst, FF_CONST_AVUTIL53 AVDictionary *src, int f
     while ((t = av_dict_get(src, "", t, AV_DICT_IGNORE_SUFFIX)))
         av_dict_set(dst, t->key, t->value, flags);
 }
+
+#ifdef TEST
+#include "time.h"
+
+static void print_dict(AVDictionary *m)
+{
+    AVDictionaryEntry *t = NULL;
+    while ((t = av_dict_get(m, "", t, AV_DICT_IGNORE_SUFFIX)))
+        printf("%s %s   ", t->key, t->value);
+    printf("\n");
+}
+
+static void bench_get(int size)
+{
+    AVDictionary *dict = NULL;
+    char key[32];
+    int i, j, found = 0;
+    int64_t t;
+
+    for (i = 0; i < size; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set(&dict, key, "value", 0);
+    }
+    t = av_gettime_relative();
+    for (j = 0; j < 1000000 / size; j++) {
+        for (i = 0; i < size; i++) {
+            snprintf(key, sizeof(key), "KEY%d", i);
+            found += !!av_dict_get(dict, key, NULL, 0);
+        }
+    }
+    t = av_gettime_relative() - t;
+    printf("%4d entries: %6.1f ns per lookup\n", size, t * 1000.0 / found);
+    av_dict_free(&dict);
+}
+
+int main(int argc, char **argv)
+{
+    AVDictionary *dict = NULL;
+    AVDictionaryEntry *e;
+    char key[32], val[32];
+    int i;
+
+    printf("Testing av_dict_set() and av_dict_get()\n");
+    for (i = 0; i < 40; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "%d", i);
+        av_dict_set(&dict, key, val, 0);
+    }
+    av_dict_set(&dict, "Key3", "case", AV_DICT_MATCH_CASE);
+    av_dict_set(&dict, "key7", NULL, 0);
+    av_dict_set(&dict, "key11", "overwritten", 0);
+    av_dict_set(&dict, "key12", "kept", AV_DICT_DONT_OVERWRITE);
+    av_dict_set(&dict, "KEY13", "-appended", AV_DICT_APPEND);
+    print_dict(dict);
+    for (i = 0; i < 42; i += 3) {
+        snprintf(key, sizeof(key), "KEY%d", i);
+        e = av_dict_get(dict, key, NULL, 0);
+        printf("%s: %s\n", key, e ? e->value : "(null)");
+    }
+    e = av_dict_get(dict, "Key3", NULL, AV_DICT_MATCH_CASE);
+    printf("Key3 (match case): %s\n", e ? e->value : "(null)");
+    e = av_dict_get(dict, "key3", NULL, AV_DICT_MATCH_CASE);
+    printf("key3 (match case): %s\n", e ? e->value : "(null)");
+    e = av_dict_get(dict, "key3", e, 0);
+    printf("key3 (next): %s\n", e ? e->value : "(null)");
+    e = av_dict_get(dict, "key2", NULL, AV_DICT_IGNORE_SUFFIX);
+    printf("key2 (ignore suffix): %s %s\n", e ? e->key : "(null)", e ? e->value : "");
+    for (i = 0; i < 40; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set(&dict, key, NULL, 0);
+    }
+    print_dict(dict);
+    av_dict_free(&dict);
+
+    /* Lookup benchmark, not run by FATE since its output varies */
+    if (argc > 1) {
+        bench_get(4);
+        bench_get(8);
+        bench_get(16);
+        bench_get(64);
+        bench_get(256);
+    }
+
+    return 0;
+}
+#endif
@@ -82,6 +82,34 @@ enum AVFrameSideDataType {
      * See libavutil/display.h for a detailed description of the data.
      */
     AV_FRAME_DATA_DISPLAYMATRIX,
+
+    /**
+     * AD-Holdings frame header, copied from the AV_PKT_DATA_AD_FRAME packet
+     * side data by the decoder. For video frames this is the 168 byte NetVu
+     * picture header, with its integers in native byte order:
+     * @code
+     * offset  type          field
+     *      0  uint32_t      version
+     *      4  int32_t       mode
+     *      8  int32_t       camera number
+     *     12  int32_t       picture mode
+     *     16  uint32_t      start offset
+     *     20  int32_t       size, maximum size, target size, Q factor
+     *     36  uint32_t      alarm bitmask, high 32 bits
+     *     40  int32_t       status
+     *     44  uint32_t      time in seconds since the Epoch, UTC
+     *     48  uint32_t      milliseconds
+     *     52  char[4]       resolution
+     *     56  char[31]      camera title
+     *     87  char[31]      alarm text
+     *    118  uint16_t[6]   source and target size, offset
+     *    130  char[30]      time zone name
+     *    160  int32_t       time zone offset in minutes
+     *    164  uint32_t      alarm bitmask, low 32 bits
+     * @endcode
+     * The strings are not necessarily 0-terminated.
+     */
+    AV_FRAME_DATA_AD_FRAME = 0x4000,
 };
 
 typedef struct AVFrameSideData {
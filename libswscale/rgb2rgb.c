@@ -80,6 +80,8 @@ void (*ff_rgb24toyv12)(const uint8_t *src, uint8_t *ydst,
                        int32_t *rgb2yuv);
 void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
                  int srcStride, int dstStride);
+void (*chroma411to420line)(const uint8_t *src1, const uint8_t *src2,
+                           uint8_t *dst, int width, int dstWidth);
 void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                         int width, int height, int src1Stride,
                         int src2Stride, int dstStride);
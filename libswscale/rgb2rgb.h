@@ -131,6 +131,13 @@ extern void (*ff_rgb24toyv12)(const uint8_t *src, uint8_t *ydst, uint8_t *udst,
 extern void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
                         int srcStride, int dstStride);
 
+/**
+ * Build one line of 4:2:0 chroma from two lines of 4:1:1 chroma of the given
+ * width. dstWidth is 2 * width or 2 * width - 1.
+ */
+extern void (*chroma411to420line)(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, int width, int dstWidth);
+
 extern void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                                int width, int height, int src1Stride,
                                int src2Stride, int dstStride);
@@ -526,6 +526,27 @@ static inline void yuy2toyv12_c(const uint8_t *src, uint8_t *ydst,
     }
 }
 
+/* each output sample is the average of the two source lines, interpolated
+ * at a quarter sample towards the nearer horizontal neighbour */
+static void chroma411to420line_c(const uint8_t *src1, const uint8_t *src2,
+                                 uint8_t *dst, int srcWidth, int dstWidth)
+{
+    int x;
+    int prev = src1[0] + src2[0];
+    int cur  = prev;
+
+    for (x = 0; x < srcWidth - 1; x++) {
+        int next = src1[x + 1] + src2[x + 1];
+        dst[2 * x]     = (3 * cur + prev + 4) >> 3;
+        dst[2 * x + 1] = (3 * cur + next + 4) >> 3;
+        prev = cur;
+        cur  = next;
+    }
+    dst[2 * x] = (3 * cur + prev + 4) >> 3;
+    if (2 * x + 1 < dstWidth)
+        dst[2 * x + 1] = (cur + 1) >> 1;
+}
+
 static inline void planar2x_c(const uint8_t *src, uint8_t *dst, int srcWidth,
                               int srcHeight, int srcStride, int dstStride)
 {
@@ -938,6 +959,7 @@ static av_cold void rgb2rgb_init_c(void)
     yuv422ptouyvy      = yuv422ptouyvy_c;
     yuy2toyv12         = yuy2toyv12_c;
     planar2x           = planar2x_c;
+    chroma411to420line = chroma411to420line_c;
     ff_rgb24toyv12     = ff_rgb24toyv12_c;
     interleaveBytes    = interleaveBytes_c;
     deinterleaveBytes  = deinterleaveBytes_c;
@@ -1340,6 +1340,52 @@ static int yvu9ToYv12Wrapper(SwsContext *c, const uint8_t *src[],
     return srcSliceH;
 }
 
+/* 4:1:1 chroma to 4:2:0, see chroma411to420line(). A line left over at the
+ * end of an odd slice gives an estimate of its output line, which the next
+ * slice completes with the other line. */
+static void chroma411to420(SwsContext *c, const uint8_t *src, int srcStride,
+                           uint8_t *dst, int dstStride,
+                           int srcSliceY, int srcSliceH)
+{
+    int y = srcSliceY, end = srcSliceY + srcSliceH;
+
+    dst += dstStride * (srcSliceY >> 1);
+    if (y & 1) {
+        uint8_t *tmp = c->formatConvBuffer;
+        int x;
+
+        chroma411to420line(src, src, tmp, c->chrSrcW, c->chrDstW);
+        for (x = 0; x < c->chrDstW; x++)
+            dst[x] = (dst[x] + tmp[x] + 1) >> 1;
+        src += srcStride;
+        dst += dstStride;
+        y++;
+    }
+    for (; y + 1 < end; y += 2) {
+        chroma411to420line(src, src + srcStride, dst, c->chrSrcW, c->chrDstW);
+        src += 2 * srcStride;
+        dst += dstStride;
+    }
+    if (y < end)
+        chroma411to420line(src, src, dst, c->chrSrcW, c->chrDstW);
+}
+
+static int yuv411pToYuv420Wrapper(SwsContext *c, const uint8_t *src[],
+                                  int srcStride[], int srcSliceY, int srcSliceH,
+                                  uint8_t *dst[], int dstStride[])
+{
+    copyPlane(src[0], srcStride[0], srcSliceY, srcSliceH, c->srcW,
+              dst[0], dstStride[0]);
+
+    chroma411to420(c, src[1], srcStride[1], dst[1], dstStride[1],
+                   srcSliceY, srcSliceH);
+    chroma411to420(c, src[2], srcStride[2], dst[2], dstStride[2],
+                   srcSliceY, srcSliceH);
+    if (dst[3])
+        fillPlane(dst[3], dstStride[3], c->srcW, srcSliceH, srcSliceY, 255);
+    return srcSliceH;
+}
+
 /* unscaled copy like stuff (assumes nearly identical formats) */
 static int packedCopyWrapper(SwsContext *c, const uint8_t *src[],
                              int srcStride[], int srcSliceY, int srcSliceH,
@@ -1591,6 +1637,14 @@ void ff_get_unscaled_swscale(SwsContext *c)
         c->swscale = yvu9ToYv12Wrapper;
     }
 
+    /* also yuvj411p to yuvj420p, as the JPEG formats are mapped to their
+     * yuv counterparts with srcRange == dstRange, like 4:1:1 MJPEG */
+    if (srcFormat == AV_PIX_FMT_YUV411P && !(dstH & 1) &&
+        (dstFormat == AV_PIX_FMT_YUV420P || dstFormat == AV_PIX_FMT_YUVA420P) &&
+        !(flags & SWS_BITEXACT)) {
+        c->swscale = yuv411pToYuv420Wrapper;
+    }
+
     /* bgr24toYV12 */
     if (srcFormat == AV_PIX_FMT_BGR24 &&
         (dstFormat == AV_PIX_FMT_YUV420P || dstFormat == AV_PIX_FMT_YUVA420P) &&
@@ -143,6 +143,77 @@ DECLARE_ALIGNED(8, extern const uint64_t, ff_bgr2UVOffset);
  32-bit C version, and and&add trick by Michael Niedermayer
 */
 
+#if HAVE_SSE2_INLINE
+static inline void chroma411to420sample(const uint8_t *src1, const uint8_t *src2,
+                                        uint8_t *dst, int i, int srcWidth,
+                                        int dstWidth)
+{
+    int l   = FFMAX(i - 1, 0), r = FFMIN(i + 1, srcWidth - 1);
+    int cur = src1[i] + src2[i];
+
+    dst[2 * i] = (3 * cur + src1[l] + src2[l] + 4) >> 3;
+    if (2 * i + 1 < dstWidth)
+        dst[2 * i + 1] = (3 * cur + src1[r] + src2[r] + 4) >> 3;
+}
+
+static void chroma411to420line_sse2(const uint8_t *src1, const uint8_t *src2,
+                                    uint8_t *dst, int srcWidth, int dstWidth)
+{
+    x86_reg x = 1;
+
+    /* 8 source samples per iteration, which read their left and right
+     * neighbours; the edges are done below */
+    if (srcWidth > 9) {
+        __asm__ volatile(
+            "pxor           %%xmm7, %%xmm7      \n\t"
+            "pcmpeqw        %%xmm6, %%xmm6      \n\t"
+            "psrlw             $15, %%xmm6      \n\t"
+            "psllw              $2, %%xmm6      \n\t" // 4
+            "1:                                 \n\t"
+            "movq     -1(%1, %0), %%xmm0        \n\t"
+            "movq     -1(%2, %0), %%xmm3        \n\t"
+            "movq       (%1, %0), %%xmm1        \n\t"
+            "movq       (%2, %0), %%xmm4        \n\t"
+            "movq      1(%1, %0), %%xmm2        \n\t"
+            "movq      1(%2, %0), %%xmm5        \n\t"
+            "punpcklbw      %%xmm7, %%xmm0      \n\t"
+            "punpcklbw      %%xmm7, %%xmm3      \n\t"
+            "punpcklbw      %%xmm7, %%xmm1      \n\t"
+            "punpcklbw      %%xmm7, %%xmm4      \n\t"
+            "punpcklbw      %%xmm7, %%xmm2      \n\t"
+            "punpcklbw      %%xmm7, %%xmm5      \n\t"
+            "paddw          %%xmm3, %%xmm0      \n\t" // prev
+            "paddw          %%xmm4, %%xmm1      \n\t" // cur
+            "paddw          %%xmm5, %%xmm2      \n\t" // next
+            "movdqa         %%xmm1, %%xmm3      \n\t"
+            "paddw          %%xmm1, %%xmm1      \n\t"
+            "paddw          %%xmm3, %%xmm1      \n\t"
+            "paddw          %%xmm6, %%xmm1      \n\t" // 3 * cur + 4
+            "paddw          %%xmm1, %%xmm0      \n\t"
+            "paddw          %%xmm1, %%xmm2      \n\t"
+            "psrlw              $3, %%xmm0      \n\t"
+            "psrlw              $3, %%xmm2      \n\t"
+            "packuswb       %%xmm0, %%xmm0      \n\t"
+            "packuswb       %%xmm2, %%xmm2      \n\t"
+            "punpcklbw      %%xmm2, %%xmm0      \n\t"
+            "movdqu         %%xmm0, (%3, %0, 2) \n\t"
+            "add                $8, %0          \n\t"
+            "cmp                %4, %0          \n\t"
+            " jl                1b              \n\t"
+            : "+r"(x)
+            : "r"(src1), "r"(src2), "r"(dst), "r"((x86_reg)srcWidth - 8)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+              "memory"
+        );
+    }
+
+    chroma411to420sample(src1, src2, dst, 0, srcWidth, dstWidth);
+    for (; x < srcWidth; x++)
+        chroma411to420sample(src1, src2, dst, x, srcWidth, dstWidth);
+}
+#endif /* HAVE_SSE2_INLINE */
+
 #endif /* HAVE_INLINE_ASM */
 
 av_cold void rgb2rgb_init_x86(void)
@@ -156,8 +227,12 @@ av_cold void rgb2rgb_init_x86(void)
         rgb2rgb_init_3dnow();
     if (INLINE_MMXEXT(cpu_flags))
         rgb2rgb_init_mmxext();
-    if (INLINE_SSE2(cpu_flags))
+    if (INLINE_SSE2(cpu_flags)) {
         rgb2rgb_init_sse2();
+#if HAVE_SSE2_INLINE
+        chroma411to420line = chroma411to420line_sse2;
+#endif
+    }
     if (INLINE_AVX(cpu_flags))
         rgb2rgb_init_avx();
 #endif /* HAVE_INLINE_ASM */
@@ -177,6 +177,19 @@ video_filter(){
         $FLAGS $ENC_OPTS -vf "$filters" -vcodec rawvideo $* -f nut md5:
 }
 
+segment_concat(){
+    list_flags=$1
+    list=${outdir}/${test}.ffconcat
+    cleanfiles="$list ${outdir}/${test}-0.nut ${outdir}/${test}-1.nut ${outdir}/${test}-2.nut"
+
+    ffmpeg -f lavfi -i testsrc=d=3:s=80x60:r=30000/1001 -c:v rawvideo \
+        -f segment -segment_time 1 -segment_format nut \
+        -segment_list_flags $list_flags -segment_list $(target_path $list) \
+        $(target_path ${outdir}/${test}-%d.nut)
+    cat $list
+    framecrc -f concat -i $(target_path $list)
+}
+
 pixdesc(){
     pix_fmts="$(ffmpeg -pix_fmts list 2>/dev/null | awk 'NR > 8 && /^IO/ { print $2 }' | sort)"
     for pix_fmt in $pix_fmts; do
@@ -21,6 +21,11 @@ fate-ffmpeg-filter_complex: CMD = framecrc -filter_complex color=d=1:r=5
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5
 
+SEGMENT_CONCAT_DEPS = LAVFI_INDEV TESTSRC_FILTER RAWVIDEO_ENCODER NUT_MUXER \
+                      SEGMENT_MUXER CONCAT_DEMUXER NUT_DEMUXER RAWVIDEO_DECODER
+FATE_FFMPEG-$(call ALLYES, $(SEGMENT_CONCAT_DEPS)) += fate-segment-ffconcat-duration
+fate-segment-ffconcat-duration: CMD = segment_concat +duration
+
 FATE_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth2.yuv
 fate-force_key_frames: CMD = enc_dec \
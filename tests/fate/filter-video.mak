@@ -65,6 +65,9 @@ fate-filter-gradfun: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf gradfun
 FATE_FILTER_VSYNTH-$(CONFIG_HQDN3D_FILTER) += fate-filter-hqdn3d
 fate-filter-hqdn3d: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf hqdn3d
 
+FATE_FILTER_VSYNTH-$(CONFIG_HQDN3D_FILTER) += fate-filter-hqdn3d-slices
+fate-filter-hqdn3d-slices: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf hqdn3d -threads 5
+
 FATE_FILTER_VSYNTH-$(CONFIG_INTERLACE_FILTER) += fate-filter-interlace
 fate-filter-interlace: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf interlace
 
@@ -77,10 +80,18 @@ fate-filter-histogram-levels: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf histogram
 FATE_FILTER_VSYNTH-$(CONFIG_HISTOGRAM_FILTER) += fate-filter-histogram-waveform
 fate-filter-histogram-waveform: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf format=yuv444p,histogram=mode=waveform -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER HFLIP_FILTER FORMAT_FILTER NEGATE_FILTER SCALE_FILTER SELECT_FILTER MOSAIC_FILTER) += fate-filter-mosaic
+fate-filter-mosaic: tests/data/filtergraphs/mosaic
+fate-filter-mosaic: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/mosaic -sws_flags +accurate_rnd+bitexact
+
 FATE_FILTER_VSYNTH-$(CONFIG_OVERLAY_FILTER) += fate-filter-overlay
 fate-filter-overlay: tests/data/filtergraphs/overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay
 
+FATE_FILTER_VSYNTH-$(call ALLYES, HFLIP_FILTER PAD_FILTER SCALE_FILTER NEGATE_FILTER OVERLAY_FILTER) += fate-filter-overlay-branch-threads
+fate-filter-overlay-branch-threads: tests/data/filtergraphs/overlay_branches
+fate-filter-overlay-branch-threads: CMD = framecrc -filter_branch_threads -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_branches
+
 FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_rgb
 fate-filter-overlay_rgb: tests/data/filtergraphs/overlay_rgb
 fate-filter-overlay_rgb: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_rgb
@@ -193,6 +204,9 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-yuvj411p
+fate-filter-scale-yuvj411p: CMD = video_filter "format=yuvj411p,scale=flags=bicubic,format=yuvj420p"
+
 FATE_FILTER_VSYNTH-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
@@ -378,8 +392,15 @@ FATE_METADATA_FILTER-$(call ALLYES, $(EBUR128_METADATA_DEPS)) += fate-filter-met
 fate-filter-metadata-ebur128: SRC = $(TARGET_SAMPLES)/filter/seq-3341-7_seq-3342-5-24bit.flac
 fate-filter-metadata-ebur128: CMD = run $(FILTER_METADATA_COMMAND) "amovie='$(SRC)',ebur128=metadata=1"
 
+MPDECIMATE_METADATA_DEPS = FFPROBE AVDEVICE LAVFI_INDEV TESTSRC_FILTER MPDECIMATE_FILTER
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(MPDECIMATE_METADATA_DEPS)) += fate-filter-metadata-mpdecimate
+fate-filter-metadata-mpdecimate: CMD = run $(FILTER_METADATA_COMMAND) "testsrc=d=2:s=160x120:r=5,mpdecimate=zones=2x2:hi=6400:lo=64"
+FATE_METADATA_FILTER_LAVFI-$(call ALLYES, $(MPDECIMATE_METADATA_DEPS)) += fate-filter-metadata-mpdecimate-downscale
+fate-filter-metadata-mpdecimate-downscale: CMD = run $(FILTER_METADATA_COMMAND) "testsrc=d=2:s=328x240:r=5,mpdecimate=zones=2x2:hi=6400:lo=64:downscale=2"
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
+FATE_FFPROBE += $(FATE_METADATA_FILTER_LAVFI-yes)
 
 fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_VSYNTH-yes)
 
-fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes)
+fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes) $(FATE_METADATA_FILTER_LAVFI-yes)
@@ -9,6 +9,11 @@ fate-idct8x8: CMD = run libavcodec/dct-test -i
 fate-idct8x8: CMP = null
 fate-idct8x8: REF = /dev/null
 
+# the frame threaded runs need thread support for a deterministic output
+FATE_LIBAVCODEC-$(filter $(HAVE_THREADS), $(CONFIG_H264_DECODER)) += fate-h264-low-delay
+fate-h264-low-delay: libavcodec/h264-test$(EXESUF)
+fate-h264-low-delay: CMD = run libavcodec/h264-test
+
 FATE_LIBAVCODEC-yes += fate-iirfilter
 fate-iirfilter: libavcodec/iirfilter-test$(EXESUF)
 fate-iirfilter: CMD = run libavcodec/iirfilter-test
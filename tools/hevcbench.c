@@ -0,0 +1,440 @@
+/*
+ * Multi-stream decoding benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode a number of video streams concurrently, the way a recorder decodes
+ * many small camera streams, and report the decoding speed and CPU time.
+ * The packets of each input file are read into memory first, so only the
+ * decoding is measured. Streams are spread over a number of worker threads,
+ * each one decoding its streams in turn one packet at a time, and each
+ * decoder can use its own frame or slice threads, which allows comparing
+ * threads per decoder against decoders per core.
+ *
+ * The decoding latency of each frame, from the time its first packet is sent
+ * to the decoder until the frame is returned, is reported too; -L opens the
+ * decoders with CODEC_FLAG_LOW_DELAY, i.e. without frame threading and
+ * without any speculative output delay, as done for live preview.
+ *
+ * Meant for HEVC, but any video decoder works. When libavcodec is built
+ * with --extra-cflags=-DHEVC_STAGE_TIMERS=1, the time spent by the HEVC
+ * decoders in each decoding stage is summed up and printed as well.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+#define MAX_STAGES 16
+
+typedef struct Input {
+    const char *filename;
+    AVCodecContext *par;    ///< stream parameters, not opened
+    AVPacket *pkts;
+    int nb_pkts;
+} Input;
+
+typedef struct Stream {
+    Input *input;
+    AVCodecContext *dec;
+    AVFrame *frame;
+    int loop, pkt, done;
+    int64_t frames;
+    int64_t *sent;          ///< time each packet was sent to the decoder
+    int64_t latency, max_latency, delay;
+} Stream;
+
+typedef struct Worker {
+    Stream **streams;
+    int nb_streams;
+} Worker;
+
+static struct {
+    char name[64];
+    double time;
+    uint64_t runs;
+} stages[MAX_STAGES];
+static int nb_stages;
+static int nb_loops = 1;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n streams] [-w worker threads] "
+            "[-t threads per decoder] [-T frame|slice|auto] [-l loops] [-L] "
+            "input [input...]\n", argv0);
+    return ret;
+}
+
+static int64_t cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+            ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
+/* Collect the stage timings, logged in the STOP_TIMER() format by each
+ * decoder (and each frame thread) when it is closed. */
+static void log_callback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    char line[256], name[64];
+    uint64_t avg;
+    unsigned runs;
+    int i;
+
+    if (!strstr(fmt, " in %s, ")) {
+        av_log_default_callback(avcl, level, fmt, vl);
+        return;
+    }
+    vsnprintf(line, sizeof(line), fmt, vl);
+    if (sscanf(line, "%"SCNu64" %*s in %63[^,], %u runs", &avg, name, &runs) != 3)
+        return;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&log_lock);
+#endif
+    for (i = 0; i < nb_stages; i++)
+        if (!strcmp(stages[i].name, name))
+            break;
+    if (i == nb_stages && nb_stages < MAX_STAGES)
+        av_strlcpy(stages[nb_stages++].name, name, sizeof(stages[i].name));
+    if (i < nb_stages) {
+        stages[i].time += avg / 10.0 * runs;
+        stages[i].runs += runs;
+    }
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&log_lock);
+#endif
+}
+
+static int read_input(Input *in)
+{
+    AVFormatContext *fmt = NULL;
+    AVPacket pkt;
+    int ret, idx;
+
+    if ((ret = avformat_open_input(&fmt, in->filename, NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(fmt, NULL)) < 0)
+        goto end;
+    idx = ret = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (ret < 0)
+        goto end;
+
+    in->par = avcodec_alloc_context3(NULL);
+    if (!in->par || (ret = avcodec_copy_context(in->par, fmt->streams[idx]->codec)) < 0) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    while ((ret = av_read_frame(fmt, &pkt)) >= 0) {
+        if (pkt.stream_index != idx) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        if ((ret = av_dup_packet(&pkt)) < 0 ||
+            (ret = av_reallocp_array(&in->pkts, in->nb_pkts + 1,
+                                     sizeof(*in->pkts))) < 0) {
+            av_free_packet(&pkt);
+            in->nb_pkts = 0;
+            goto end;
+        }
+        in->pkts[in->nb_pkts++] = pkt;
+    }
+    ret = in->nb_pkts ? 0 : AVERROR_INVALIDDATA;
+
+end:
+    avformat_close_input(&fmt);
+    return ret;
+}
+
+/* Decode one packet of the stream, or drain the decoder once all the
+ * packets of the last loop have been sent. */
+static int decode_step(Stream *st)
+{
+    AVPacket pkt;
+    int got_frame, ret;
+
+    if (st->pkt < st->input->nb_pkts) {
+        pkt     = st->input->pkts[st->pkt];
+        pkt.pts = st->pkt;
+        st->sent[st->pkt++] = av_gettime_relative();
+    } else {
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+    }
+
+    ret = avcodec_decode_video2(st->dec, st->frame, &got_frame, &pkt);
+    if (got_frame) {
+        int64_t idx = st->frame->pkt_pts;
+        if (idx >= 0 && idx < st->input->nb_pkts) {
+            int64_t latency = av_gettime_relative() - st->sent[idx];
+            st->latency    += latency;
+            st->max_latency = FFMAX(st->max_latency, latency);
+            st->delay      += st->pkt - 1 - idx;
+        }
+        st->frames++;
+        av_frame_unref(st->frame);
+    }
+
+    if (!pkt.data) {
+        if (got_frame && ret >= 0)
+            return 0;
+        if (++st->loop < nb_loops) {
+            avcodec_flush_buffers(st->dec);
+            st->pkt = 0;
+            return 0;
+        }
+        st->done = 1;
+    }
+    return 0;
+}
+
+static void *worker_thread(void *arg)
+{
+    Worker *w = arg;
+    int i, running;
+
+    do {
+        running = 0;
+        for (i = 0; i < w->nb_streams; i++) {
+            if (w->streams[i]->done)
+                continue;
+            decode_step(w->streams[i]);
+            running = 1;
+        }
+    } while (running);
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_streams = 16, nb_workers = 1, nb_threads = 1, thread_type = 0;
+    int low_delay = 0;
+    Input *inputs = NULL;
+    Stream *streams = NULL;
+    Worker *workers = NULL;
+#if HAVE_PTHREADS
+    pthread_t *tids = NULL;
+#endif
+    int nb_inputs = 0;
+    int64_t start_time, start_cpu, total_frames = 0;
+    int64_t latency = 0, max_latency = 0, delay = 0;
+    double elapsed, cpu, total_stages = 0;
+    int i, ret = 1;
+
+    av_register_all();
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_streams = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            nb_workers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            nb_threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+            nb_loops = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-L")) {
+            low_delay = 1;
+        } else if (!strcmp(argv[i], "-T") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "frame"))
+                thread_type = FF_THREAD_FRAME;
+            else if (!strcmp(argv[i], "slice"))
+                thread_type = FF_THREAD_SLICE;
+            else if (!strcmp(argv[i], "auto"))
+                thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            else
+                return usage(argv[0], 1);
+        } else if (argv[i][0] == '-') {
+            return usage(argv[0], 1);
+        } else {
+            break;
+        }
+    }
+    nb_inputs = argc - i;
+    if (nb_streams <= 0 || nb_workers <= 0 || nb_threads < 0 ||
+        nb_loops <= 0 || !nb_inputs)
+        return usage(argv[0], 1);
+#if !HAVE_PTHREADS
+    nb_workers = 1;
+#endif
+    nb_workers = FFMIN(nb_workers, nb_streams);
+
+    av_log_set_callback(log_callback);
+
+    inputs  = av_mallocz_array(nb_inputs,  sizeof(*inputs));
+    streams = av_mallocz_array(nb_streams, sizeof(*streams));
+    workers = av_mallocz_array(nb_workers, sizeof(*workers));
+    if (!inputs || !streams || !workers)
+        goto fail;
+    for (i = 0; i < nb_workers; i++) {
+        workers[i].streams = av_mallocz_array(nb_streams / nb_workers + 1,
+                                              sizeof(*workers[i].streams));
+        if (!workers[i].streams)
+            goto fail;
+    }
+
+    for (i = 0; i < nb_inputs; i++) {
+        inputs[i].filename = argv[argc - nb_inputs + i];
+        if (read_input(&inputs[i]) < 0) {
+            fprintf(stderr, "Unable to read %s\n", inputs[i].filename);
+            goto fail;
+        }
+    }
+
+    for (i = 0; i < nb_streams; i++) {
+        Stream *st = &streams[i];
+        Worker *w  = &workers[i % nb_workers];
+        AVCodec *codec;
+
+        st->input = &inputs[i % nb_inputs];
+        codec     = avcodec_find_decoder(st->input->par->codec_id);
+        st->dec   = avcodec_alloc_context3(codec);
+        st->frame = av_frame_alloc();
+        st->sent  = av_malloc_array(st->input->nb_pkts, sizeof(*st->sent));
+        if (!codec || !st->dec || !st->frame || !st->sent ||
+            avcodec_copy_context(st->dec, st->input->par) < 0)
+            goto fail;
+        st->dec->thread_count = nb_threads;
+        if (thread_type)
+            st->dec->thread_type = thread_type;
+        if (low_delay)
+            st->dec->flags |= CODEC_FLAG_LOW_DELAY;
+        if (avcodec_open2(st->dec, codec, NULL) < 0) {
+            fprintf(stderr, "Unable to open the decoder for %s\n",
+                    st->input->filename);
+            goto fail;
+        }
+        w->streams[w->nb_streams++] = st;
+    }
+
+    start_time = av_gettime_relative();
+    start_cpu  = cpu_time();
+#if HAVE_PTHREADS
+    if (nb_workers > 1) {
+        tids = av_mallocz_array(nb_workers, sizeof(*tids));
+        if (!tids)
+            goto fail;
+        for (i = 0; i < nb_workers; i++)
+            if (pthread_create(&tids[i], NULL, worker_thread, &workers[i])) {
+                fprintf(stderr, "Unable to start worker thread %d\n", i);
+                while (i--)
+                    pthread_join(tids[i], NULL);
+                goto fail;
+            }
+        for (i = 0; i < nb_workers; i++)
+            pthread_join(tids[i], NULL);
+    } else
+#endif
+        worker_thread(&workers[0]);
+    elapsed = (av_gettime_relative() - start_time) / 1000000.0;
+    cpu     = (cpu_time() - start_cpu) / 1000000.0;
+
+    /* closing the decoders logs the stage timings */
+    for (i = 0; i < nb_streams; i++) {
+        total_frames += streams[i].frames;
+        latency      += streams[i].latency;
+        max_latency   = FFMAX(max_latency, streams[i].max_latency);
+        delay        += streams[i].delay;
+        avcodec_close(streams[i].dec);
+    }
+
+    printf("streams: %d, workers: %d, threads per decoder: %d, "
+           "frames: %"PRId64", time: %.3fs\n",
+           nb_streams, nb_workers, nb_threads, total_frames, elapsed);
+    printf("fps: %.1f total, %.1f per stream\n",
+           total_frames / elapsed, total_frames / elapsed / nb_streams);
+#if HAVE_GETRUSAGE
+    printf("cpu: %.3fs, %.3fms per frame\n",
+           cpu, total_frames ? 1000.0 * cpu / total_frames : 0);
+#endif
+    if (total_frames)
+        printf("latency: %.3fms average, %.3fms max, %.2f packets average\n",
+               latency / 1000.0 / total_frames, max_latency / 1000.0,
+               (double)delay / total_frames);
+
+    /* residual decoding and motion compensation are part of the CTB stage */
+    for (i = 0; i < nb_stages; i++)
+        if (strcmp(stages[i].name, "hevc residual") &&
+            strcmp(stages[i].name, "hevc mc"))
+            total_stages += stages[i].time;
+    if (nb_stages)
+        printf("%-16s %14s %12s %10s %6s\n",
+               "stage", "cycles", "calls", "per call", "share");
+    for (i = 0; i < nb_stages; i++)
+        printf("%-16s %14.0f %12"PRIu64" %10.1f %5.1f%%\n",
+               stages[i].name, stages[i].time, stages[i].runs,
+               stages[i].time / stages[i].runs,
+               100.0 * stages[i].time / total_stages);
+    ret = 0;
+
+fail:
+#if HAVE_PTHREADS
+    av_free(tids);
+#endif
+    for (i = 0; streams && i < nb_streams; i++) {
+        if (streams[i].dec) {
+            avcodec_close(streams[i].dec);
+            av_freep(&streams[i].dec->extradata);
+        }
+        av_freep(&streams[i].dec);
+        av_frame_free(&streams[i].frame);
+        av_freep(&streams[i].sent);
+    }
+    for (i = 0; inputs && i < nb_inputs; i++) {
+        while (inputs[i].nb_pkts)
+            av_free_packet(&inputs[i].pkts[--inputs[i].nb_pkts]);
+        av_freep(&inputs[i].pkts);
+        if (inputs[i].par) {
+            avcodec_close(inputs[i].par);
+            av_freep(&inputs[i].par->extradata);
+        }
+        av_freep(&inputs[i].par);
+    }
+    for (i = 0; workers && i < nb_workers; i++)
+        av_free(workers[i].streams);
+    av_free(workers);
+    av_free(streams);
+    av_free(inputs);
+    return ret;
+}
@@ -0,0 +1,181 @@
+/*
+ * UDP receive load generator
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Send a number of constant rate UDP streams over the loopback interface
+ * and receive them through the udp protocol, then report the received
+ * packet rate and the CPU time spent per stream. Useful to compare the
+ * receive and send options of the udp protocol, e.g. recv_batch and
+ * send_batch. The packets sent for a stream in each 1 ms tick are
+ * considered a frame, after which the send queue is flushed.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n streams] [-r packets per second per stream] "
+            "[-s packet size] [-d duration] [-p first port] "
+            "[-o udp input url options] [-O udp output url options]\n", argv0);
+    return ret;
+}
+
+static int64_t cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+            ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    int nb_streams = 50, rate = 100, size = 1316, duration = 5, port = 20000;
+    const char *opts = "fifo_size=50000&overrun_nonfatal=1", *out_opts = "";
+    URLContext **in = NULL, **out = NULL;
+    int64_t *sent = NULL, *received = NULL;
+    int64_t start_time, start_cpu, now, total_sent = 0, total_received = 0;
+    double elapsed, cpu;
+    uint8_t *buf = NULL;
+    char url[1024];
+    int i, ret = 1;
+
+    av_register_all();
+    avformat_network_init();
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_streams = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rate = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            opts = argv[++i];
+        } else if (!strcmp(argv[i], "-O") && i + 1 < argc) {
+            out_opts = argv[++i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (nb_streams <= 0 || rate <= 0 || size <= 0 || size > 65507 ||
+        duration <= 0)
+        return usage(argv[0], 1);
+
+    in       = av_mallocz_array(nb_streams, sizeof(*in));
+    out      = av_mallocz_array(nb_streams, sizeof(*out));
+    sent     = av_mallocz_array(nb_streams, sizeof(*sent));
+    received = av_mallocz_array(nb_streams, sizeof(*received));
+    buf      = av_mallocz(65536);
+    if (!in || !out || !sent || !received || !buf)
+        goto fail;
+
+    for (i = 0; i < nb_streams; i++) {
+        snprintf(url, sizeof(url), "udp://127.0.0.1:%d?pkt_size=%d&%s",
+                 port + i, size, opts);
+        if (ffurl_open(&in[i], url, AVIO_FLAG_READ | AVIO_FLAG_NONBLOCK,
+                       NULL, NULL) < 0) {
+            fprintf(stderr, "Unable to open %s\n", url);
+            goto fail;
+        }
+        snprintf(url, sizeof(url), "udp://127.0.0.1:%d?pkt_size=%d&%s",
+                 port + i, size, out_opts);
+        if (ffurl_open(&out[i], url, AVIO_FLAG_WRITE, NULL, NULL) < 0) {
+            fprintf(stderr, "Unable to open %s\n", url);
+            goto fail;
+        }
+    }
+
+    start_time = av_gettime_relative();
+    start_cpu  = cpu_time();
+    do {
+        now = av_gettime_relative() - start_time;
+        for (i = 0; i < nb_streams; i++) {
+            while (sent[i] < now * rate / AV_TIME_BASE) {
+                AV_WB32(buf, sent[i]);
+                if (ffurl_write(out[i], buf, size) < 0)
+                    break;
+                sent[i]++;
+            }
+            ff_udp_flush(out[i]);
+            while (ffurl_read(in[i], buf, 65536) > 0)
+                received[i]++;
+        }
+        av_usleep(1000);
+    } while (now < duration * (int64_t)AV_TIME_BASE);
+    /* Let the receivers catch up with the last packets sent */
+    av_usleep(100000);
+    for (i = 0; i < nb_streams; i++)
+        while (ffurl_read(in[i], buf, 65536) > 0)
+            received[i]++;
+    elapsed = (av_gettime_relative() - start_time) / 1000000.0;
+    cpu     = (cpu_time() - start_cpu) / 1000000.0;
+
+    for (i = 0; i < nb_streams; i++) {
+        total_sent     += sent[i];
+        total_received += received[i];
+    }
+    printf("streams: %d, sent: %"PRId64", received: %"PRId64" (%.2f%% lost)\n",
+           nb_streams, total_sent, total_received,
+           total_sent ? 100.0 * (total_sent - total_received) / total_sent : 0);
+    printf("packets/sec per stream: %.1f\n",
+           total_received / elapsed / nb_streams);
+#if HAVE_GETRUSAGE
+    printf("cpu usage per stream: %.3f%% (sender included)\n",
+           100.0 * cpu / elapsed / nb_streams);
+#endif
+    ret = 0;
+
+fail:
+    for (i = 0; i < nb_streams; i++) {
+        if (in && in[i])
+            ffurl_close(in[i]);
+        if (out && out[i])
+            ffurl_close(out[i]);
+    }
+    av_free(in);
+    av_free(out);
+    av_free(sent);
+    av_free(received);
+    av_free(buf);
+    avformat_network_deinit();
+    return ret;
+}